@@ -0,0 +1,152 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <unordered_set>
+
+#include "../core/vector.h"
+#include "../indexes/dynamic_index.h"
+#include "metrics.h"
+
+using namespace std;
+using namespace vdb;
+
+/* -------------------------------
+   Simple CLI parsing
+--------------------------------*/
+size_t get_arg(int argc, char** argv, const string& name, size_t default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) {
+            return static_cast<size_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    return default_val;
+}
+
+string get_str(int argc, char** argv, const string& name, const string& default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) return argv[i + 1];
+    }
+    return default_val;
+}
+
+/* -------------------------------
+   Churn workload: every round deletes a fraction of the live labels,
+   inserts as many new ones and times a batch of queries. The same
+   operations run against an index that never compacts and one that
+   compacts in the background past --ratio tombstones.
+--------------------------------*/
+template<typename Index, typename... Args>
+void run(const string& name, Index empty, size_t N, size_t D, size_t K, size_t Q, size_t rounds,
+         size_t churn_pct, double ratio, Args... extra) {
+    mt19937 rng(42);
+    normal_distribution<float> dist(0.0f, 1.0f);
+
+    DynamicConfig never;
+    never.compact_ratio = 2.0;   // dead rows never reach twice the stored ones
+    DynamicConfig bg;
+    bg.compact_ratio = ratio;
+
+    DynamicIndex<Index> plain(empty, never);
+    DynamicIndex<Index> compacting(std::move(empty), bg);
+
+    vector<uint64_t> live(N);
+    vector<float> data(N * D);
+    for (size_t i = 0; i < N; ++i) live[i] = i;
+    for (auto& x : data) x = dist(rng);
+    plain.upsert_batch(live.data(), data.data(), N);
+    compacting.upsert_batch(live.data(), data.data(), N);
+    uint64_t next = N;
+
+    vector<Vector> queries;
+    for (size_t q = 0; q < Q; ++q) {
+        Vector v(D);
+        for (auto& x : v.data) x = dist(rng);
+        queries.push_back(v);
+    }
+
+    cout << name << "\n";
+    cout << setw(7) << "round" << setw(14) << "dead (plain)" << setw(14) << "plain ms/q"
+         << setw(14) << "dead (cmp)" << setw(14) << "compact ms/q" << "\n";
+
+    bool ok = true;
+    const size_t churn = N * churn_pct / 100;
+    for (size_t r = 0; r <= rounds; ++r) {
+        if (r > 0) {
+            unordered_set<uint64_t> gone;
+            for (size_t i = 0; i < churn; ++i) {
+                size_t at = rng() % live.size();
+                gone.insert(live[at]);
+                plain.remove(live[at]);
+                compacting.remove(live[at]);
+                live[at] = live.back();
+                live.pop_back();
+            }
+
+            vector<uint64_t> labels(churn);
+            vector<float> rows(churn * D);
+            for (auto& l : labels) l = next++;
+            for (auto& x : rows) x = dist(rng);
+            plain.upsert_batch(labels.data(), rows.data(), churn);
+            compacting.upsert_batch(labels.data(), rows.data(), churn);
+            live.insert(live.end(), labels.begin(), labels.end());
+
+            for (auto& q : queries)
+                for (auto& h : compacting.search(q, K, extra...)) ok &= !gone.count(h.first);
+        }
+
+        auto time_queries = [&](const DynamicIndex<Index>& index) {
+            Timer t;
+            for (auto& q : queries) index.search(q, K, extra...);
+            return t.elapsed_ms() / Q;
+        };
+
+        double plain_ms = time_queries(plain);
+        double cmp_ms = time_queries(compacting);
+
+        cout << setw(7) << r << fixed << setprecision(3)
+             << setw(14) << plain.tombstone_ratio() << setw(14) << plain_ms
+             << setw(14) << compacting.tombstone_ratio() << setw(14) << cmp_ms << "\n";
+    }
+
+    compacting.wait_compaction();
+    ok &= compacting.size() == live.size() && plain.size() == live.size();
+    cout << (ok ? "deleted labels never returned, sizes match\n\n" : "MISMATCH\n\n");
+}
+
+int main(int argc, char** argv) {
+    const size_t N       = get_arg(argc, argv, "--N",       100000);
+    const size_t D       = get_arg(argc, argv, "--dim",     64);
+    const size_t K       = get_arg(argc, argv, "--K",       10);
+    const size_t Q       = get_arg(argc, argv, "--queries", 100);
+    const size_t ROUNDS  = get_arg(argc, argv, "--rounds",  10);
+    const size_t CHURN   = get_arg(argc, argv, "--churn",   10);
+    const size_t RATIO   = get_arg(argc, argv, "--ratio",   20);
+    const size_t NLIST   = get_arg(argc, argv, "--nlist",   256);
+    const size_t NPROBE  = get_arg(argc, argv, "--nprobe",  16);
+    const string INDEX   = get_str(argc, argv, "--index",   "both");
+
+    cout << "Dynamic update benchmark: churn with and without compaction\n";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  queries=" << Q << "  rounds=" << ROUNDS
+         << "  churn=" << CHURN << "%/round  compact at " << RATIO << "% dead\n\n";
+
+    if (INDEX == "linear" || INDEX == "both") {
+        run("LinearScanIndex", LinearScanIndex(D), N, D, K, Q, ROUNDS, CHURN, RATIO / 100.0);
+    }
+
+    if (INDEX == "ivf" || INDEX == "both") {
+        mt19937 rng(7);
+        normal_distribution<float> dist(0.0f, 1.0f);
+        const size_t T = min<size_t>(N, NLIST * 40);
+        vector<float> train(T * D);
+        for (auto& x : train) x = dist(rng);
+
+        IVFIndex ivf(D, NLIST);
+        ivf.train(train.data(), T);
+        run("IVFIndex (nprobe " + to_string(NPROBE) + ")", std::move(ivf), N, D, K, Q, ROUNDS, CHURN,
+            RATIO / 100.0, NPROBE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <memory>
+
+#include "../core/vector.h"
+#include "../core/parallel.h"
+#include "../indexes/hnsw/hnsw_graph.h"
+#include "../indexes/linear_scan.h"
+#include "metrics.h"
+
+using namespace std;
+using namespace vdb;
+
+/* -------------------------------
+   Simple CLI parsing
+--------------------------------*/
+size_t get_arg(int argc, char** argv, const string& name, size_t default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) {
+            return static_cast<size_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    return default_val;
+}
+
+int main(int argc, char** argv) {
+    const size_t N       = get_arg(argc, argv, "--N",       100000);
+    const size_t D       = get_arg(argc, argv, "--dim",     64);
+    const size_t K       = get_arg(argc, argv, "--K",       10);
+    const size_t Q       = get_arg(argc, argv, "--queries", 200);
+    const size_t M       = get_arg(argc, argv, "--M",       16);
+    const size_t EFC     = get_arg(argc, argv, "--efc",     200);
+    const size_t THREADS = get_arg(argc, argv, "--threads", max_threads());
+    const bool PREFETCH  = get_arg(argc, argv, "--prefetch", 1) != 0;
+
+    cout << "HNSW benchmark (build scaling + Recall@K)\n";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  M=" << M << "  efC=" << EFC
+         << "  queries=" << Q << "  max threads=" << THREADS
+         << "  prefetch=" << PREFETCH << "\n\n";
+
+    /* -------------------------------
+       Clustered random data
+    --------------------------------*/
+    mt19937 rng(123);
+    normal_distribution<float> dist(0.0f, 1.0f);
+
+    const size_t n_blobs = 128;
+    vector<float> blobs(n_blobs * D);
+    for (auto& x : blobs) x = dist(rng) * 4.0f;
+
+    auto sample = [&](float* out) {
+        const float* c = blobs.data() + (rng() % n_blobs) * D;
+        for (size_t d = 0; d < D; ++d) out[d] = c[d] + dist(rng);
+    };
+
+    vector<float> data(N * D);
+    for (size_t i = 0; i < N; ++i) sample(data.data() + i * D);
+
+    vector<Vector> queries(Q, Vector(D));
+    for (auto& q : queries) sample(q.raw());
+
+    HNSWConfig hcfg;
+    hcfg.M = M;
+    hcfg.ef_construction = EFC;
+    hcfg.prefetch = PREFETCH;
+
+    /* -------------------------------
+       Ground truth (exact scan)
+    --------------------------------*/
+    SearchConfig exact_cfg;
+    exact_cfg.exec = ExecPolicy::OPENMP;
+
+    LinearScanIndex exact(D, exact_cfg);
+    exact.add_batch(data.data(), N);
+    vector<vector<uint32_t>> gt;
+    for (auto& r : exact.batch_search(queries, K)) {
+        vector<uint32_t> ids;
+        for (auto& p : r) ids.push_back(p.first);
+        gt.push_back(ids);
+    }
+
+    /* -------------------------------
+       Build time vs. thread count
+    --------------------------------*/
+    cout << left
+         << setw(10) << "threads"
+         << setw(15) << "Build(ms)"
+         << setw(15) << "Inserts/s"
+         << setw(10) << "Speedup"
+         << "\n";
+
+    vector<size_t> counts;
+    for (size_t t = 1; t < THREADS; t *= 2) counts.push_back(t);
+    counts.push_back(THREADS);
+
+    unique_ptr<HNSWIndex> index;
+    double base_ms = 0.0;
+    for (size_t t : counts) {
+        SearchConfig cfg;
+        cfg.exec = t > 1 ? ExecPolicy::OPENMP : ExecPolicy::SINGLE_THREAD;
+        cfg.num_threads = static_cast<int>(t);
+
+        index = make_unique<HNSWIndex>(D, hcfg, cfg);
+
+        Timer build_timer;
+        index->add_batch(data.data(), N);
+        double build_ms = build_timer.elapsed_ms();
+        if (t == 1) base_ms = build_ms;
+
+        cout << left
+             << setw(10) << t
+             << setw(15) << build_ms
+             << setw(15) << (N * 1000.0 / build_ms)
+             << setw(10) << (base_ms / build_ms)
+             << "\n";
+    }
+
+    /* -------------------------------
+       ef sweep on the last graph, with
+       batched/prefetched expansion off and on
+    --------------------------------*/
+    cout << "\n" << left
+         << setw(10) << "prefetch"
+         << setw(10) << "ef"
+         << setw(15) << "Search(ms)"
+         << setw(12) << "QPS"
+         << setw(10) << "Recall@K"
+         << "\n";
+
+    for (size_t ef = K; ef <= 512; ef *= 2)
+    for (bool pf : {false, true}) {
+        index->set_prefetch(pf);
+        float recall_sum = 0.0f;
+
+        Timer search_timer;
+        vector<vector<uint32_t>> results;
+        for (const auto& q : queries) {
+            vector<uint32_t> ids;
+            for (auto& p : index->search(q, K, ef)) ids.push_back(p.first);
+            results.push_back(ids);
+        }
+        double search_ms = search_timer.elapsed_ms();
+
+        for (size_t i = 0; i < Q; ++i) recall_sum += recall_at_k(gt[i], results[i]);
+
+        cout << left
+             << setw(10) << pf
+             << setw(10) << ef
+             << setw(15) << search_ms
+             << setw(12) << (Q * 1000.0 / search_ms)
+             << setw(10) << (recall_sum / Q)
+             << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <algorithm>
+
+#include "../core/vector.h"
+#include "../core/parallel.h"
+#include "../indexes/ivf.h"
+#include "../indexes/linear_scan.h"
+#include "dataset_loader.h"
+#include "metrics.h"
+
+using namespace std;
+using namespace vdb;
+
+/* -------------------------------
+   Simple CLI parsing
+--------------------------------*/
+size_t get_arg(int argc, char** argv, const string& name, size_t default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) {
+            return static_cast<size_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    return default_val;
+}
+
+string get_str(int argc, char** argv, const string& name, const string& default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) return argv[i + 1];
+    }
+    return default_val;
+}
+
+/* -------------------------------
+   k-means++ sanity check: on well-
+   separated blobs every seed must be
+   a distinct data point and each blob
+   must get exactly one seed
+--------------------------------*/
+bool check_kmeanspp_seeding() {
+    const size_t k = 16, per = 64, dim = 16;
+    mt19937 rng(5);
+    normal_distribution<float> noise(0.0f, 1.0f);
+
+    // blob c sits 100 units out along axis c
+    vector<float> pts(k * per * dim);
+    for (size_t i = 0; i < k * per; ++i)
+        for (size_t d = 0; d < dim; ++d) pts[i * dim + d] = (d == i % k ? 100.0f : 0.0f) + noise(rng);
+
+    KMeansConfig kcfg;
+    kcfg.max_iters = 0;                   // seeds only
+    kcfg.max_points_per_centroid = 0;
+    kcfg.seed_points_per_centroid = per;  // seed on every point
+    VectorStore seeds = kmeans(pts.data(), k * per, dim, k, kcfg);
+
+    vector<bool> blob_hit(k, false);
+    for (size_t s = 0; s < seeds.size(); ++s) {
+        const float* c = seeds.row(s);
+        bool is_point = false;
+        for (size_t i = 0; i < k * per && !is_point; ++i) is_point = equal(c, c + dim, pts.data() + i * dim);
+
+        const size_t blob = max_element(c, c + dim) - c;
+        if (!is_point || blob_hit[blob]) return false;
+        blob_hit[blob] = true;
+    }
+    return seeds.size() == k;
+}
+
+int main(int argc, char** argv) {
+    if (!check_kmeanspp_seeding()) {
+        cerr << "k-means++ seeding check failed: seeds are not one data point per cluster\n";
+        return 1;
+    }
+
+    size_t N             = get_arg(argc, argv, "--N",       100000);
+    size_t D             = get_arg(argc, argv, "--dim",     64);
+    const size_t K       = get_arg(argc, argv, "--K",       10);
+    const size_t Q       = get_arg(argc, argv, "--queries", 200);
+    const size_t NLIST   = get_arg(argc, argv, "--nlist",   256);
+    const size_t BATCH   = get_arg(argc, argv, "--batch",   0);
+    const size_t THREADS = get_arg(argc, argv, "--threads", 0);
+    const size_t CHUNK   = get_arg(argc, argv, "--chunk",   65536);
+    const string BASE    = get_str(argc, argv, "--base",    "");   // e.g. sift_base.fvecs
+    const string QUERY   = get_str(argc, argv, "--query",   "");   // e.g. sift_query.fvecs
+
+    if (CHUNK == 0) {
+        cerr << "Error: --chunk must be positive\n";
+        return 1;
+    }
+
+    // --base streams a real dataset from disk (fvecs / bvecs / fbin ...):
+    // the file is mapped and fed to add_batch chunk by chunk
+    unique_ptr<VecsFile> base;
+    if (!BASE.empty()) {
+        base.reset(new VecsFile(BASE));
+        N = min(N, base->n());
+        D = base->dim();
+    }
+
+    cout << "IVF benchmark (with Recall@K)\n";
+    if (base) cout << "base=" << BASE << "  ";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  nlist=" << NLIST
+         << "  queries=" << Q << "  threads=" << (THREADS ? THREADS : max_threads())
+         << "  kmeans=" << (BATCH ? "mini-batch " + to_string(BATCH) : string("lloyd")) << "\n\n";
+
+    /* -------------------------------
+       Clustered random data, so that
+       the coarse quantizer has structure
+       (unless --base is given)
+    --------------------------------*/
+    mt19937 rng(123);
+    normal_distribution<float> dist(0.0f, 1.0f);
+
+    const size_t n_blobs = max<size_t>(1, NLIST / 2);
+    vector<float> blobs(n_blobs * D);
+    for (auto& x : blobs) x = dist(rng) * 4.0f;
+
+    auto sample = [&](float* out) {
+        const float* c = blobs.data() + (rng() % n_blobs) * D;
+        for (size_t d = 0; d < D; ++d) out[d] = c[d] + dist(rng);
+    };
+
+    vector<float> data;
+    if (!base) {
+        data.resize(N * D);
+        for (size_t i = 0; i < N; ++i) sample(data.data() + i * D);
+    }
+
+    // feeds all N base vectors to add(rows, count), in file chunks or at once
+    auto ingest = [&](auto&& add) {
+        if (base) base->for_each_chunk(CHUNK, [&](const float* rows, size_t, size_t cnt) { add(rows, cnt); }, N);
+        else add(data.data(), N);
+    };
+
+    vector<Vector> queries(Q, Vector(D));
+    if (!QUERY.empty()) {
+        Dataset qs = load_vectors(QUERY);
+        if (qs.dim != D) throw runtime_error("query dim does not match the base");
+        queries.resize(min(Q, qs.n), Vector(D));
+        for (size_t q = 0; q < queries.size(); ++q) copy_n(qs.data.data() + q * D, D, queries[q].raw());
+    } else {
+        for (auto& q : queries) sample(q.raw());
+    }
+
+    SearchConfig cfg;
+    cfg.exec = ExecPolicy::OPENMP;
+    cfg.num_threads = static_cast<int>(THREADS);
+
+    /* -------------------------------
+       Ground truth (exact scan)
+    --------------------------------*/
+    LinearScanIndex exact(D, cfg);
+    ingest([&](const float* rows, size_t cnt) { exact.add_batch(rows, cnt); });
+    vector<vector<uint32_t>> gt;
+    for (auto& r : exact.batch_search(queries, K)) {
+        vector<uint32_t> ids;
+        for (auto& p : r) ids.push_back(p.first);
+        gt.push_back(ids);
+    }
+
+    /* -------------------------------
+       Train + add
+    --------------------------------*/
+    IVFIndex ivf(D, NLIST, cfg);
+
+    KMeansConfig kcfg;
+    kcfg.batch_size = BATCH;
+
+    // a file is trained on its first 256 * nlist rows (k-means samples
+    // about that many anyway); synthetic data on all of it
+    vector<float> train_rows;
+    size_t n_train = N;
+    if (base) {
+        n_train = min(N, 256 * NLIST);
+        train_rows.resize(n_train * D);
+        base->to_float(0, n_train, train_rows.data());
+    }
+
+    Timer train_timer;
+    ivf.train(base ? train_rows.data() : data.data(), n_train, kcfg);
+    double train_ms = train_timer.elapsed_ms();
+
+    Timer add_timer;
+    ingest([&](const float* rows, size_t cnt) { ivf.add_batch(rows, cnt); });
+    double add_ms = add_timer.elapsed_ms();
+
+    cout << "Train time:   " << train_ms << " ms\n";
+    cout << "Add time:     " << add_ms   << " ms\n\n";
+
+    /* -------------------------------
+       nprobe sweep
+    --------------------------------*/
+    cout << left
+         << setw(10) << "nprobe"
+         << setw(15) << "Search(ms)"
+         << setw(12) << "QPS"
+         << setw(10) << "Recall@K"
+         << "\n";
+
+    for (size_t nprobe = 1; nprobe <= NLIST; nprobe *= 2) {
+        float recall_sum = 0.0f;
+
+        Timer search_timer;
+        vector<vector<uint32_t>> results;
+        for (const auto& q : queries) {
+            vector<uint32_t> ids;
+            for (auto& p : ivf.search(q, K, nprobe)) ids.push_back(p.first);
+            results.push_back(ids);
+        }
+        double search_ms = search_timer.elapsed_ms();
+
+        for (size_t i = 0; i < queries.size(); ++i) recall_sum += recall_at_k(gt[i], results[i]);
+
+        cout << left
+             << setw(10) << nprobe
+             << setw(15) << search_ms
+             << setw(12) << (queries.size() * 1000.0 / search_ms)
+             << setw(10) << (recall_sum / queries.size())
+             << "\n";
+    }
+
+    return 0;
+}
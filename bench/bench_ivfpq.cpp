@@ -0,0 +1,144 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <iomanip>
+
+#include "../core/vector.h"
+#include "../core/parallel.h"
+#include "../indexes/ivfpq.h"
+#include "../indexes/linear_scan.h"
+#include "metrics.h"
+
+using namespace std;
+using namespace vdb;
+
+/* -------------------------------
+   Simple CLI parsing
+--------------------------------*/
+size_t get_arg(int argc, char** argv, const string& name, size_t default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) {
+            return static_cast<size_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    return default_val;
+}
+
+int main(int argc, char** argv) {
+    const size_t N       = get_arg(argc, argv, "--N",       100000);
+    const size_t D       = get_arg(argc, argv, "--dim",     64);
+    const size_t K       = get_arg(argc, argv, "--K",       10);
+    const size_t Q       = get_arg(argc, argv, "--queries", 200);
+    const size_t NLIST   = get_arg(argc, argv, "--nlist",   256);
+    const size_t M       = get_arg(argc, argv, "--M",       16);
+    const size_t NBITS   = get_arg(argc, argv, "--nbits",   8);
+    const size_t REFINE  = get_arg(argc, argv, "--refine",  4);
+    const size_t THREADS = get_arg(argc, argv, "--threads", 0);
+
+    cout << "IVF-PQ benchmark (with Recall@K)\n";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  nlist=" << NLIST
+         << "  M=" << M << "  nbits=" << NBITS << "  refine=" << REFINE
+         << "  queries=" << Q << "  threads=" << (THREADS ? THREADS : max_threads()) << "\n\n";
+
+    /* -------------------------------
+       Clustered random data, so that
+       the coarse quantizer has structure
+    --------------------------------*/
+    mt19937 rng(123);
+    normal_distribution<float> dist(0.0f, 1.0f);
+
+    const size_t n_blobs = max<size_t>(1, NLIST / 2);
+    vector<float> blobs(n_blobs * D);
+    for (auto& x : blobs) x = dist(rng) * 4.0f;
+
+    auto sample = [&](float* out) {
+        const float* c = blobs.data() + (rng() % n_blobs) * D;
+        for (size_t d = 0; d < D; ++d) out[d] = c[d] + dist(rng);
+    };
+
+    vector<float> data(N * D);
+    for (size_t i = 0; i < N; ++i) sample(data.data() + i * D);
+
+    vector<Vector> queries(Q, Vector(D));
+    for (auto& q : queries) sample(q.raw());
+
+    SearchConfig cfg;
+    cfg.exec = ExecPolicy::OPENMP;
+    cfg.num_threads = static_cast<int>(THREADS);
+
+    /* -------------------------------
+       Ground truth (exact scan)
+    --------------------------------*/
+    LinearScanIndex exact(D, cfg);
+    exact.add_batch(data.data(), N);
+    vector<vector<uint32_t>> gt;
+    for (auto& r : exact.batch_search(queries, K)) {
+        vector<uint32_t> ids;
+        for (auto& p : r) ids.push_back(p.first);
+        gt.push_back(ids);
+    }
+
+    /* -------------------------------
+       Train + add; the raw vectors are
+       kept aside for the refine stage
+    --------------------------------*/
+    IVFPQIndex ivf(D, NLIST, M, cfg, NBITS);
+
+    Timer train_timer;
+    ivf.train(data.data(), N);
+    double train_ms = train_timer.elapsed_ms();
+
+    Timer add_timer;
+    ivf.add_batch(data.data(), N);
+    double add_ms = add_timer.elapsed_ms();
+
+    VectorStore raw(D);
+    raw.resize(N);
+    copy(data.begin(), data.end(), raw.data());
+    ivf.set_refine_store(&raw);
+
+    cout << "Train time:   " << train_ms << " ms\n";
+    cout << "Add time:     " << add_ms   << " ms\n";
+    cout << "Code bytes:   " << ivf.pq().code_size() << " (raw " << D * sizeof(float) << ")\n\n";
+
+    /* -------------------------------
+       nprobe sweep
+    --------------------------------*/
+    cout << left
+         << setw(10) << "nprobe"
+         << setw(10) << "refine"
+         << setw(15) << "Search(ms)"
+         << setw(12) << "QPS"
+         << setw(10) << "Recall@K"
+         << "\n";
+
+    for (size_t nprobe = 1; nprobe <= NLIST; nprobe *= 2) {
+        for (size_t refine : {size_t(0), REFINE}) {
+            float recall_sum = 0.0f;
+
+            Timer search_timer;
+            vector<vector<uint32_t>> results;
+            for (const auto& q : queries) {
+                vector<uint32_t> ids;
+                for (auto& p : ivf.search(q, K, nprobe, refine)) ids.push_back(p.first);
+                results.push_back(ids);
+            }
+            double search_ms = search_timer.elapsed_ms();
+
+            for (size_t i = 0; i < Q; ++i) recall_sum += recall_at_k(gt[i], results[i]);
+
+            cout << left
+                 << setw(10) << nprobe
+                 << setw(10) << refine
+                 << setw(15) << search_ms
+                 << setw(12) << (Q * 1000.0 / search_ms)
+                 << setw(10) << (recall_sum / Q)
+                 << "\n";
+
+            if (REFINE == 0) break;
+        }
+    }
+
+    return 0;
+}
@@ -28,9 +28,10 @@ int main(int argc, char** argv) {
     const size_t N   = get_arg(argc, argv, "--N",   100000);
     const size_t D   = get_arg(argc, argv, "--dim", 1024);
     const size_t K   = get_arg(argc, argv, "--K",   10);
+    const size_t LEAF = get_arg(argc, argv, "--leaf", 32);
 
     cout << "KD-tree benchmark (with Recall@K)\n";
-    cout << "N=" << N << "  dim=" << D << "  K=" << K << "\n\n";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  leaf=" << LEAF << "\n\n";
 
     /* -------------------------------
        Random data
@@ -50,7 +51,7 @@ int main(int argc, char** argv) {
     /* -------------------------------
        Build KD-tree
     --------------------------------*/
-    KDTree kd_tree(D);
+    KDTree kd_tree(D, {}, LEAF);
     KDTreeStats stats;
 
     Timer build_timer;
@@ -64,7 +65,7 @@ int main(int argc, char** argv) {
     for (auto& x : query.data) x = dist(rng);
 
     vector<size_t> kd_indices;
-    vector<size_t> kd_dists;
+    vector<dist_t> kd_dists;
 
     Timer search_timer;
     kd_tree.search(query, K, kd_indices, kd_dists , &stats);
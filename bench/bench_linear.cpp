@@ -5,25 +5,38 @@
 #include <cassert>
 #include <string>
 #include <cstring>
-#include <omp.h>
 
 #include "../core/vector.h"
 #include "../core/types.h"
+#include "../core/cpu_dispatch.h"
+#include "../core/parallel.h"
 #include "../indexes/linear_scan.h"
+#include "dataset_loader.h"
 #include "metrics.h"
 
 using namespace std;
 using namespace vdb;
 
-static constexpr dim_t DIM = 4;
+static constexpr dim_t DEFAULT_DIM = 4;
 static constexpr size_t DATASET_SIZE = 100000;
 static constexpr size_t NUM_QUERIES = 1000;
 static constexpr size_t K = 10;
+static constexpr size_t CLUSTERS = 1000;        // --data clustered
+static constexpr float CLUSTER_SPREAD = 0.5f;   // per-dim stddev around a centre
 
 struct CLIArgs {
     int threads = 1;
+    dim_t dim = DEFAULT_DIM;
     string structure = "aos";
-    string type = "scalar";
+    string type = "auto";
+    bool batch = false;
+    string parallel = "intra";
+    bool scaling = false;
+    string encoding = "fp32";
+    size_t refine = 0;
+    string data = "gauss";
+    string base;
+    string query;
     bool show_help = false;
 };
 
@@ -32,11 +45,28 @@ void print_usage(const char* prog_name) {
               << "Options:\n"
               << "  --threads <N>        Number of threads (default: 1, use 0 for auto)\n"
               << "  --structure <TYPE>   Memory layout: aos or soa (default: aos)\n"
-              << "  --type <TYPE>        Distance computation: scalar or avx2 (default: scalar)\n"
+              << "  --type <TYPE>        Distance kernels: scalar, sse4, avx2, avx512 or auto (default: auto)\n"
+              << "  --dim <D>            Vector dimension (default: 4)\n"
+              << "  --data <KIND>        Synthetic data: gauss (i.i.d. normal) or clustered (" << CLUSTERS
+              << " Gaussian blobs) (default: gauss)\n"
+              << "  --base <PATH>        Base vectors from a .fvecs/.bvecs/.fbin/.u8bin file, first " << DATASET_SIZE
+              << " rows (sets the dimension)\n"
+              << "  --query <PATH>       Query vectors from a file (default: the last base rows are held out)\n"
+              << "  --batch              Score all queries with batch_search\n"
+              << "  --parallel <MODE>    Multi-thread mode: intra (split each scan) or inter (split queries, needs --batch) (default: intra)\n"
+              << "  --scaling            Report a thread-scaling curve from 1 thread to all cores\n"
+              << "  --encoding <E>       Vector storage: fp32, sq8, fp16, bf16 or binary (default: fp32)\n"
+              << "  --refine <F>         Re-rank the best K*F code distances with fp32 vectors (default: 0 = off,\n"
+              << "                       binary always re-ranks, 0 = its default oversample)\n"
               << "  --help               Show this help message\n\n"
               << "Examples:\n"
               << "  " << prog_name << " --threads 10 --structure aos --type avx2\n"
-              << "  " << prog_name << " --threads 4 --type scalar\n";
+              << "  " << prog_name << " --threads 4 --type scalar\n"
+              << "  " << prog_name << " --structure soa --type avx2 --dim 128\n"
+              << "  " << prog_name << " --batch --parallel inter --scaling --dim 128\n"
+              << "  " << prog_name << " --encoding sq8 --refine 4 --dim 768\n"
+              << "  " << prog_name << " --encoding binary --data clustered --dim 1024\n"
+              << "  " << prog_name << " --base sift_base.fvecs --query sift_query.fvecs --type avx2\n";
 }
 
 CLIArgs parse_args(int argc, char* argv[]) {
@@ -50,7 +80,21 @@ CLIArgs parse_args(int argc, char* argv[]) {
             return args;
         }
         else if (arg == "--threads" && i + 1 < argc) {
-            stoi(argv[++i]);
+            args.threads = stoi(argv[++i]);
+            if (args.threads < 0) {
+                cerr << "Error: threads must be >= 0\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--parallel" && i + 1 < argc) {
+            args.parallel = argv[++i];
+            if (args.parallel != "intra" && args.parallel != "inter") {
+                cerr << "Error: parallel must be 'intra' or 'inter'\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--scaling") {
+            args.scaling = true;
         }
         else if (arg == "--structure" && i + 1 < argc) {
             args.structure = argv[++i];
@@ -59,10 +103,45 @@ CLIArgs parse_args(int argc, char* argv[]) {
                 exit(1);
             }
         }
+        else if (arg == "--encoding" && i + 1 < argc) {
+            args.encoding = argv[++i];
+            if (args.encoding != "fp32" && args.encoding != "sq8" && args.encoding != "fp16" && args.encoding != "bf16" &&
+                args.encoding != "binary") {
+                cerr << "Error: encoding must be 'fp32', 'sq8', 'fp16', 'bf16' or 'binary'\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--data" && i + 1 < argc) {
+            args.data = argv[++i];
+            if (args.data != "gauss" && args.data != "clustered") {
+                cerr << "Error: data must be 'gauss' or 'clustered'\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--base" && i + 1 < argc) {
+            args.base = argv[++i];
+        }
+        else if (arg == "--query" && i + 1 < argc) {
+            args.query = argv[++i];
+        }
+        else if (arg == "--refine" && i + 1 < argc) {
+            args.refine = stoul(argv[++i]);
+        }
+        else if (arg == "--batch") {
+            args.batch = true;
+        }
+        else if (arg == "--dim" && i + 1 < argc) {
+            args.dim = stoul(argv[++i]);
+            if (args.dim == 0) {
+                cerr << "Error: dim must be positive\n";
+                exit(1);
+            }
+        }
         else if (arg == "--type" && i + 1 < argc) {
             args.type = argv[++i];
-            if (args.type != "scalar" && args.type != "avx2") {
-                cerr << "Error: type must be 'scalar' or 'avx2'\n";
+            if (args.type != "scalar" && args.type != "sse4" && args.type != "avx2" &&
+                args.type != "avx512" && args.type != "auto") {
+                cerr << "Error: type must be 'scalar', 'sse4', 'avx2', 'avx512' or 'auto'\n";
                 exit(1);
             }
         }
@@ -73,30 +152,36 @@ CLIArgs parse_args(int argc, char* argv[]) {
         }
     }
     
+    if (!args.query.empty() && args.base.empty()) {
+        cerr << "Error: --query needs --base\n";
+        exit(1);
+    }
+
     return args;
 }
 
-SearchConfig create_config(const CLIArgs& args) {
+SearchConfig create_config(const CLIArgs& args, int threads) {
     SearchConfig cfg;
     
     // Set distance type
     if (args.type == "scalar") {
         cfg.distance = DistanceType::L2_SCALAR;
+    } else if (args.type == "sse4") {
+        cfg.distance = DistanceType::L2_SSE4;
     } else if (args.type == "avx2") {
         cfg.distance = DistanceType::L2_AVX2;
+    } else if (args.type == "avx512") {
+        cfg.distance = DistanceType::L2_AVX512;
+    } else {
+        cfg.distance = DistanceType::AUTO;
     }
     
     // Set execution policy
-    if (args.threads == 1) {
+    if (threads == 1) {
         cfg.exec = ExecPolicy::SINGLE_THREAD;
     } else {
-        cfg.exec = ExecPolicy::OPENMP;
-        // Set number of threads for OpenMP if needed
-        #ifdef _OPENMP
-        if (args.threads > 0) {
-            omp_set_num_threads(args.threads);
-        }
-        #endif
+        cfg.exec = args.parallel == "inter" ? ExecPolicy::OPENMP_BATCH : ExecPolicy::OPENMP;
+        cfg.num_threads = threads;  // 0 = all cores
     }
     
     // Set layout type
@@ -105,6 +190,17 @@ SearchConfig create_config(const CLIArgs& args) {
     } else if (args.structure == "soa") {
         cfg.layout = LayoutType::SOA;
     }
+
+    // Set vector encoding
+    if (args.encoding == "sq8") {
+        cfg.encoding = VectorEncoding::SQ8;
+    } else if (args.encoding == "fp16") {
+        cfg.encoding = VectorEncoding::FP16;
+    } else if (args.encoding == "bf16") {
+        cfg.encoding = VectorEncoding::BF16;
+    } else if (args.encoding == "binary") {
+        cfg.encoding = VectorEncoding::BINARY;
+    }
     
     return cfg;
 }
@@ -116,6 +212,33 @@ Vector random_vector(dim_t d, mt19937& rng) {
     return v;
 }
 
+// n vectors from a mixture of CLUSTERS blobs, appended to out. Embeddings
+// look like this rather than like i.i.d. noise: neighbours share a centre,
+// so they also share most signs, which is what BINARY relies on.
+void clustered_vectors(const vector<float>& centres, dim_t d, size_t n, mt19937& rng, vector<float>& out) {
+    normal_distribution<float> noise(0.0f, CLUSTER_SPREAD);
+    uniform_int_distribution<size_t> pick(0, centres.size() / d - 1);
+    for (size_t i = 0; i < n; ++i) {
+        const float* c = centres.data() + pick(rng) * d;
+        for (dim_t j = 0; j < d; ++j) out.push_back(c[j] + noise(rng));
+    }
+}
+
+// rows [begin, begin + count) of a vector file as Vector queries
+vector<Vector> file_queries(const VecsFile& file, size_t begin, size_t count) {
+    vector<float> rows(count * file.dim());
+    file.to_float(begin, count, rows.data());
+
+    vector<Vector> out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Vector v(file.dim());
+        copy(rows.begin() + i * file.dim(), rows.begin() + (i + 1) * file.dim(), v.data.begin());
+        out.push_back(v);
+    }
+    return out;
+}
+
 vector<uint32_t> extract_ids(
     const vector<pair<uint32_t, float>>& res
 ) {
@@ -132,27 +255,42 @@ struct BenchResult {
 
 BenchResult run_benchmark(
     const string& name,
+    dim_t dim,
     const SearchConfig& cfg,
-    const vector<Vector>& dataset,
+    const vector<float>& dataset,   // row-major, n x dim
     const vector<Vector>& queries,
-    const vector<vector<uint32_t>>& gt_ids
+    const vector<vector<uint32_t>>& gt_ids,
+    bool batch,
+    size_t refine
 ) {
     cout << "\n[RUN] " << name << endl;
 
     /* Build index */
     Timer t_build;
-    LinearScanIndex index(DIM, cfg);
-    for (const auto& v : dataset) index.add(v);
+    LinearScanIndex index(dim, cfg);
+    index.add_batch(dataset.data(), dataset.size() / dim);
     double build_ms = t_build.elapsed_ms();
 
+    // fp32 rows for the re-rank of a compressed index
+    VectorStore raw(dim);
+    if (refine > 0) {
+        raw.resize(dataset.size() / dim);
+        copy(dataset.begin(), dataset.end(), raw.data());
+        index.set_refine_store(&raw);
+    }
+
     /* Search */
     Timer t_search;
     vector<vector<uint32_t>> results;
     results.reserve(queries.size());
 
-    for (const auto& q : queries) {
-        auto r = index.search(q, K);
-        results.push_back(extract_ids(r));
+    if (batch) {
+        for (auto& r : index.batch_search(queries, K)) results.push_back(extract_ids(r));
+    } else {
+        for (const auto& q : queries) {
+            auto r = index.search(q, K, nullptr, refine);
+            results.push_back(extract_ids(r));
+        }
     }
     double search_ms = t_search.elapsed_ms();
 
@@ -163,6 +301,7 @@ BenchResult run_benchmark(
     }
     float recall = recall_sum / queries.size();
 
+    cout << "  Bytes/vector : " << index.code_size() << "\n";
     cout << "  Build time   : " << build_ms  << " ms\n";
     cout << "  Search time  : " << search_ms << " ms\n";
     cout << "  QPS          : " 
@@ -184,29 +323,77 @@ int main(int argc, char* argv[]) {
     
     mt19937 rng(42);
 
+    /* Dataset: a vector file, or synthetic base rows and queries */
+    vector<float> flat;
+    vector<Vector> queries;
+    string source = args.data;
+
+    if (!args.base.empty()) {
+        VecsFile base(args.base);
+        args.dim = base.dim();
+        source = args.base;
+
+        // without a query file the last rows are held out as queries
+        size_t n = min(base.n(), DATASET_SIZE + (args.query.empty() ? NUM_QUERIES : 0));
+        if (args.query.empty()) {
+            const size_t nq = min(NUM_QUERIES, n / 2);
+            n -= nq;
+            queries = file_queries(base, n, nq);
+        } else {
+            VecsFile qf(args.query);
+            if (qf.dim() != base.dim()) {
+                cerr << "Error: query dimension " << qf.dim() << " does not match base dimension " << base.dim() << "\n";
+                return 1;
+            }
+            queries = file_queries(qf, 0, min(qf.n(), NUM_QUERIES));
+        }
+
+        flat.resize(n * args.dim);
+        base.to_float(0, n, flat.data());
+    } else if (args.data == "clustered") {
+        vector<float> centres;
+        for (size_t i = 0; i < CLUSTERS; ++i) {
+            Vector c = random_vector(args.dim, rng);
+            centres.insert(centres.end(), c.data.begin(), c.data.end());
+        }
+
+        flat.reserve(DATASET_SIZE * args.dim);
+        clustered_vectors(centres, args.dim, DATASET_SIZE, rng, flat);
+
+        vector<float> q;
+        clustered_vectors(centres, args.dim, NUM_QUERIES, rng, q);
+        for (size_t i = 0; i < NUM_QUERIES; ++i) {
+            Vector v(args.dim);
+            copy(q.begin() + i * args.dim, q.begin() + (i + 1) * args.dim, v.data.begin());
+            queries.push_back(v);
+        }
+    } else {
+        flat.reserve(DATASET_SIZE * args.dim);
+        for (size_t i = 0; i < DATASET_SIZE; ++i) {
+            Vector v = random_vector(args.dim, rng);
+            flat.insert(flat.end(), v.data.begin(), v.data.end());
+        }
+
+        queries.reserve(NUM_QUERIES);
+        for (size_t i = 0; i < NUM_QUERIES; ++i) {
+            queries.push_back(random_vector(args.dim, rng));
+        }
+    }
+    const size_t n = flat.size() / args.dim;
+
     cout << "\n===== VectorDB Linear Scan Benchmark =====\n";
-    cout << "Dataset size : " << DATASET_SIZE << "\n";
-    cout << "Dimension    : " << DIM << "\n";
-    cout << "Queries      : " << NUM_QUERIES << "\n";
+    cout << "Dataset      : " << source << "\n";
+    cout << "Dataset size : " << n << "\n";
+    cout << "Dimension    : " << args.dim << "\n";
+    cout << "Queries      : " << queries.size() << "\n";
     cout << "Top-K        : " << K << "\n";
     cout << "\nConfiguration:\n";
-    cout << "  Threads      : " << (args.threads == 0 ? "auto" : to_string(args.threads)) << "\n";
+    cout << "  Threads      : " << (args.threads == 0 ? "auto" : to_string(args.threads))
+         << " (available: " << max_threads() << ", mode: " << args.parallel << ")\n";
     cout << "  Structure    : " << args.structure << "\n";
-    cout << "  Type         : " << args.type << "\n";
-
-    /* Generate dataset */
-    vector<Vector> dataset;
-    dataset.reserve(DATASET_SIZE);
-    for (size_t i = 0; i < DATASET_SIZE; ++i) {
-        dataset.push_back(random_vector(DIM, rng));
-    }
-
-    /* Generate queries */
-    vector<Vector> queries;
-    queries.reserve(NUM_QUERIES);
-    for (size_t i = 0; i < NUM_QUERIES; ++i) {
-        queries.push_back(random_vector(DIM, rng));
-    }
+    cout << "  Encoding     : " << args.encoding << (args.refine ? " (refine x" + to_string(args.refine) + ")" : string()) << "\n";
+    cout << "  Type         : " << args.type
+         << " (resolved: " << simd_level_name(kernels_for(create_config(args, args.threads).distance).level) << ")\n";
 
     /* Ground truth (scalar baseline) */
     cout << "\n[INFO] Computing ground truth...\n";
@@ -215,8 +402,8 @@ int main(int argc, char* argv[]) {
     gt_cfg.exec = ExecPolicy::SINGLE_THREAD;
     gt_cfg.layout = LayoutType::AOS;
 
-    LinearScanIndex gt_index(DIM, gt_cfg);
-    for (const auto& v : dataset) gt_index.add(v);
+    LinearScanIndex gt_index(args.dim, gt_cfg);
+    gt_index.add_batch(flat.data(), n);
 
     vector<vector<uint32_t>> gt_ids;
     for (const auto& q : queries) {
@@ -224,19 +411,62 @@ int main(int argc, char* argv[]) {
         gt_ids.push_back(extract_ids(r));
     }
 
+    if (args.scaling) {
+        /* Thread-scaling curve: 1, 2, 4, ... and finally all cores */
+        vector<int> counts;
+        for (int t = 1; t < max_threads(); t *= 2) counts.push_back(t);
+        counts.push_back(max_threads());
+
+        vector<BenchResult> runs;
+        for (int t : counts) {
+            string name = args.type + (args.batch ? " batch" : "") + " (" + args.structure + ", "
+                        + to_string(t) + " threads, " + args.parallel + ")";
+            runs.push_back(run_benchmark(name, args.dim, create_config(args, t), flat, queries, gt_ids, args.batch, args.refine));
+        }
+
+        cout << "\n===== THREAD SCALING =====\n";
+        cout << left
+                  << setw(10) << "Threads"
+                  << setw(15) << "Search(ms)"
+                  << setw(12) << "QPS"
+                  << setw(10) << "Speedup"
+                  << setw(10) << "Recall"
+                  << "\n";
+
+        bool ok = true;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            cout << left
+                      << setw(10) << counts[i]
+                      << setw(15) << runs[i].search_ms
+                      << setw(12) << (queries.size() * 1000.0 / runs[i].search_ms)
+                      << setw(10) << (runs[0].search_ms / runs[i].search_ms)
+                      << setw(10) << runs[i].recall
+                      << "\n";
+            ok = ok && runs[i].recall >= 0.99f;
+        }
+
+        if (!ok) {
+            cerr << "\n✗ Warning: Recall is below expected threshold!\n";
+            return 1;
+        }
+
+        cout << "\n✔ Benchmark completed successfully\n";
+        return 0;
+    }
+
     /* Create configuration from CLI args */
-    SearchConfig test_cfg = create_config(args);
+    SearchConfig test_cfg = create_config(args, args.threads);
     
     /* Build name for the test */
-    string test_name = args.type + " (" + args.structure + ", ";
+    string test_name = args.type + (args.batch ? " batch" : "") + " (" + args.structure + ", ";
     if (args.threads == 1) {
         test_name += "single thread)";
     } else {
-        test_name += std::to_string(args.threads) + " threads)";
+        test_name += (args.threads == 0 ? string("all") : std::to_string(args.threads)) + " threads, " + args.parallel + ")";
     }
 
     /* Run benchmark */
-    BenchResult result = run_benchmark(test_name, test_cfg, dataset, queries, gt_ids);
+    BenchResult result = run_benchmark(test_name, args.dim, test_cfg, flat, queries, gt_ids, args.batch, args.refine);
 
     cout << "\n===== SUMMARY =====\n";
     cout << left
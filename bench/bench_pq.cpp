@@ -0,0 +1,166 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <iomanip>
+
+#include "../core/vector.h"
+#include "../core/topk.h"
+#include "../core/cpu_dispatch.h"
+#include "../indexes/pq.h"
+#include "../indexes/linear_scan.h"
+#include "metrics.h"
+
+using namespace std;
+using namespace vdb;
+
+/* -------------------------------
+   Simple CLI parsing
+--------------------------------*/
+size_t get_arg(int argc, char** argv, const string& name, size_t default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) {
+            return static_cast<size_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    return default_val;
+}
+
+int main(int argc, char** argv) {
+    const size_t N = get_arg(argc, argv, "--N",       100000);
+    const size_t D = get_arg(argc, argv, "--dim",     64);
+    const size_t K = get_arg(argc, argv, "--K",       10);
+    const size_t Q = get_arg(argc, argv, "--queries", 100);
+
+    cout << "PQ (ADC flat scan) benchmark\n";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  queries=" << Q
+         << "  simd=" << simd_level_name(best_kernels().level) << "\n\n";
+
+    /* -------------------------------
+       Clustered random data
+    --------------------------------*/
+    mt19937 rng(123);
+    normal_distribution<float> dist(0.0f, 1.0f);
+
+    const size_t n_blobs = 128;
+    vector<float> blobs(n_blobs * D);
+    for (auto& x : blobs) x = dist(rng) * 4.0f;
+
+    auto sample = [&](float* out) {
+        const float* c = blobs.data() + (rng() % n_blobs) * D;
+        for (size_t d = 0; d < D; ++d) out[d] = c[d] + dist(rng);
+    };
+
+    vector<float> data(N * D);
+    for (size_t i = 0; i < N; ++i) sample(data.data() + i * D);
+
+    vector<Vector> queries(Q, Vector(D));
+    for (auto& q : queries) sample(q.raw());
+
+    SearchConfig cfg;
+    cfg.exec = ExecPolicy::OPENMP;
+
+    /* -------------------------------
+       Ground truth (exact scan)
+    --------------------------------*/
+    LinearScanIndex exact(D, cfg);
+    exact.add_batch(data.data(), N);
+    vector<vector<uint32_t>> gt;
+    for (auto& r : exact.batch_search(queries, K)) {
+        vector<uint32_t> ids;
+        for (auto& p : r) ids.push_back(p.first);
+        gt.push_back(ids);
+    }
+
+    /* -------------------------------
+       M sweep: train, encode, scan with
+       the scalar and best kernels. 8-bit
+       codes use the float ADC table, 4-bit
+       codes the packed fast-scan layout
+    --------------------------------*/
+    cout << left
+         << setw(6)  << "bits"
+         << setw(6)  << "M"
+         << setw(12) << "Bytes/vec"
+         << setw(14) << "Train(ms)"
+         << setw(14) << "Encode(ms)"
+         << setw(16) << "Scalar QPS"
+         << setw(16) << "SIMD QPS"
+         << setw(10) << "Recall@K"
+         << "\n";
+
+    for (size_t nbits : {8, 4}) {
+        for (size_t M : {4, 8, 16, 32, 64}) {
+            if (D % M != 0) continue;
+
+            ProductQuantizer pq(D, M, cfg, nbits);
+
+            Timer train_timer;
+            pq.train(data.data(), N);
+            double train_ms = train_timer.elapsed_ms();
+
+            vector<uint8_t> codes(N * pq.code_size());
+            Timer encode_timer;
+            pq.encode_batch(data.data(), N, codes.data());
+            double encode_ms = encode_timer.elapsed_ms();
+
+            vector<uint8_t> packed;
+            if (nbits == 4) {
+                packed.resize(pq.fastscan_size(N));
+                pq.pack_fastscan(codes.data(), N, packed.data());
+            }
+
+            const size_t nb = (N + PQ_FASTSCAN_BLOCK - 1) / PQ_FASTSCAN_BLOCK;
+            vector<float> table(M * pq.ksub());
+            ProductQuantizer::FastScanLUT lut;
+            vector<uint16_t> sums(nb * PQ_FASTSCAN_BLOCK);
+            vector<dist_t> dists(N);
+
+            auto scan = [&](const DistanceKernels& kern, const float* q) {
+                if (nbits == 8) {
+                    pq.compute_distance_table(q, table.data());
+                    kern.pq_adc(table.data(), codes.data(), N, M, dists.data());
+                    return;
+                }
+                pq.compute_fastscan_lut(q, lut);
+                kern.pq_fastscan(lut.lut.data(), packed.data(), nb, (M + 1) / 2, sums.data());
+                for (size_t i = 0; i < N; ++i) dists[i] = sums[i] / lut.scale + lut.bias;
+            };
+
+            auto run = [&](const DistanceKernels& kern, vector<vector<uint32_t>>& results) {
+                Timer t;
+                for (const auto& q : queries) {
+                    scan(kern, q.raw());
+
+                    TopKCollector top(K);
+                    top.push_range(dists.data(), N, 0);
+
+                    vector<uint32_t> ids;
+                    for (auto& p : top.sorted_results()) ids.push_back(p.first);
+                    results.push_back(ids);
+                }
+                return t.elapsed_ms();
+            };
+
+            vector<vector<uint32_t>> scalar_res, simd_res;
+            double scalar_ms = run(kernels_for(SimdLevel::SCALAR), scalar_res);
+            double simd_ms   = run(best_kernels(), simd_res);
+
+            float recall_sum = 0.0f;
+            for (size_t i = 0; i < Q; ++i) recall_sum += recall_at_k(gt[i], simd_res[i]);
+
+            cout << left
+                 << setw(6)  << nbits
+                 << setw(6)  << M
+                 << setw(12) << pq.code_size()
+                 << setw(14) << train_ms
+                 << setw(14) << encode_ms
+                 << setw(16) << (Q * 1000.0 / scalar_ms)
+                 << setw(16) << (Q * 1000.0 / simd_ms)
+                 << setw(10) << (recall_sum / Q)
+                 << "\n";
+        }
+    }
+
+    return 0;
+}
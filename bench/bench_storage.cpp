@@ -0,0 +1,172 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <cstdio>
+
+#include "../core/vector.h"
+#include "../indexes/linear_scan.h"
+#include "../indexes/ivf.h"
+#include "../indexes/kd_tree.h"
+#include "../storage/serialization.h"
+#include "metrics.h"
+
+using namespace std;
+using namespace vdb;
+
+/* -------------------------------
+   Simple CLI parsing
+--------------------------------*/
+size_t get_arg(int argc, char** argv, const string& name, size_t default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) {
+            return static_cast<size_t>(std::stoul(argv[i + 1]));
+        }
+    }
+    return default_val;
+}
+
+string get_str(int argc, char** argv, const string& name, const string& default_val) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (argv[i] == name) return argv[i + 1];
+    }
+    return default_val;
+}
+
+void report(const string& name, double build_ms, double save_ms, double load_ms, double first_ms, bool same) {
+    cout << left << setw(12) << name << right << fixed << setprecision(2)
+         << setw(12) << build_ms << setw(10) << save_ms << setw(10) << load_ms
+         << setw(14) << first_ms << "   " << (same ? "identical" : "MISMATCH") << "\n";
+}
+
+int main(int argc, char** argv) {
+    const size_t N       = get_arg(argc, argv, "--N",       100000);
+    const size_t D       = get_arg(argc, argv, "--dim",     64);
+    const size_t K       = get_arg(argc, argv, "--K",       10);
+    const size_t Q       = get_arg(argc, argv, "--queries", 100);
+    const size_t NLIST   = get_arg(argc, argv, "--nlist",   256);
+    const size_t NPROBE  = get_arg(argc, argv, "--nprobe",  16);
+    const size_t SOA     = get_arg(argc, argv, "--soa",     0);
+    const size_t POP     = get_arg(argc, argv, "--populate", 0);
+    const string PATH    = get_str(argc, argv, "--path",    "/tmp/vdb_bench");
+
+    cout << "Storage benchmark: save, mmap load vs rebuild\n";
+    cout << "N=" << N << "  dim=" << D << "  K=" << K << "  queries=" << Q
+         << "  layout=" << (SOA ? "SOA" : "AOS") << "  populate=" << POP << "\n\n";
+
+    mt19937 rng(123);
+    normal_distribution<float> dist(0.0f, 1.0f);
+
+    vector<float> data(N * D);
+    for (auto& x : data) x = dist(rng);
+
+    vector<Vector> queries;
+    for (size_t q = 0; q < Q; ++q) {
+        Vector v(D);
+        for (auto& x : v.data) x = dist(rng);
+        queries.push_back(move(v));
+    }
+
+    SearchConfig cfg;
+    cfg.layout = SOA ? LayoutType::SOA : LayoutType::AOS;
+
+    MapOptions opts;
+    opts.populate = POP != 0;
+
+    cout << left << setw(12) << "index" << right << setw(12) << "build ms" << setw(10) << "save ms"
+         << setw(10) << "load ms" << setw(14) << "1st query ms" << "   results\n";
+
+    /* -------------------------------
+       Linear scan
+    --------------------------------*/
+    {
+        const string path = PATH + ".flat";
+        Timer t;
+        LinearScanIndex built(D, cfg);
+        built.add_batch(data.data(), N);
+        double build_ms = t.elapsed_ms();
+
+        t.reset();
+        save_index(built, path);
+        double save_ms = t.elapsed_ms();
+
+        t.reset();
+        LinearScanIndex loaded = load_linear_scan(path, {}, opts);
+        double load_ms = t.elapsed_ms();
+
+        t.reset();
+        bool same = loaded.search(queries[0], K) == built.search(queries[0], K);
+        double first_ms = t.elapsed_ms();
+        for (size_t q = 1; q < Q; ++q) same &= loaded.search(queries[q], K) == built.search(queries[q], K);
+
+        report("linear", build_ms, save_ms, load_ms, first_ms, same);
+        remove(path.c_str());
+    }
+
+    /* -------------------------------
+       IVF
+    --------------------------------*/
+    {
+        const string path = PATH + ".ivf";
+        Timer t;
+        IVFIndex built(D, NLIST, cfg);
+        built.train(data.data(), N);
+        built.add_batch(data.data(), N);
+        double build_ms = t.elapsed_ms();
+
+        t.reset();
+        save_index(built, path);
+        double save_ms = t.elapsed_ms();
+
+        t.reset();
+        IVFIndex loaded = load_ivf(path, {}, opts);
+        double load_ms = t.elapsed_ms();
+
+        t.reset();
+        bool same = loaded.search(queries[0], K, NPROBE) == built.search(queries[0], K, NPROBE);
+        double first_ms = t.elapsed_ms();
+        for (size_t q = 1; q < Q; ++q) same &= loaded.search(queries[q], K, NPROBE) == built.search(queries[q], K, NPROBE);
+
+        report("ivf", build_ms, save_ms, load_ms, first_ms, same);
+        remove(path.c_str());
+    }
+
+    /* -------------------------------
+       KD-tree
+    --------------------------------*/
+    {
+        const string path = PATH + ".kd";
+        Timer t;
+        KDTree built(D, cfg);
+        built.build(data.data(), N);
+        double build_ms = t.elapsed_ms();
+
+        t.reset();
+        save_index(built, path);
+        double save_ms = t.elapsed_ms();
+
+        t.reset();
+        KDTree loaded = load_kd_tree(path, {}, opts);
+        double load_ms = t.elapsed_ms();
+
+        vector<size_t> ia, ib;
+        vector<dist_t> da, db;
+
+        t.reset();
+        loaded.search(queries[0], K, ia, da);
+        double first_ms = t.elapsed_ms();
+        built.search(queries[0], K, ib, db);
+        bool same = ia == ib && da == db;
+        for (size_t q = 1; q < Q; ++q) {
+            loaded.search(queries[q], K, ia, da);
+            built.search(queries[q], K, ib, db);
+            same &= ia == ib && da == db;
+        }
+
+        report("kd-tree", build_ms, save_ms, load_ms, first_ms, same);
+        remove(path.c_str());
+    }
+
+    return 0;
+}
@@ -1,46 +1,168 @@
 #include "dataset_loader.h"
-#include <fstream>
-#include <sstream>
 #include <stdexcept>
+#include <cstring>
 
-Dataset load_fvecs(const string &path){
-    Dataset ds;
-    ifstream ifs(path , ios::binary);
-    if (!ifs) throw runtime_error("failed to open " + path);
+#include <sys/stat.h>
+
+#include "../core/half.h"
+#include "../core/parallel.h"
 
-    while(ifs) {
-        u_int32_t dim = 0;
-        ifs.read(reinterpret_cast<char*>(&dim) , sizeof(dim));
-        if(!ifs) break;
+namespace {
 
-        vector<float> vec(dim);
-        ifs.read(reinterpret_cast<char*>(vec.data()) , sizeof(float)*dim);
-        if(!ifs) break;
+    constexpr size_t PARALLEL_MIN = 1 << 16;   // elements; below this the team start-up dominates
 
-        if(ds.dim = 0) ds.dim = dim;
-        if(dim != ds.dim) throw runtime_error("inconsistent dim in fvecs");
+    VecsFormat format_of(const string& path){
+        const size_t dot = path.rfind('.');
+        const string ext = dot == string::npos ? "" : path.substr(dot + 1);
 
-        ds.data.insert(ds.data.end() , vec.begin() , vec.end());
-        ds.n++;
+        if(ext == "fvecs")  return VecsFormat::FVECS;
+        if(ext == "bvecs")  return VecsFormat::BVECS;
+        if(ext == "ivecs")  return VecsFormat::IVECS;
+        if(ext == "fbin" || ext == "bin") return VecsFormat::FBIN;
+        if(ext == "u8bin")  return VecsFormat::U8BIN;
+        if(ext == "ibin")   return VecsFormat::IBIN;
+        if(ext == "f16bin") return VecsFormat::F16BIN;
+        throw runtime_error("unknown vector file extension: " + path);
     }
 
-    return ds;
+    VecsType type_of(VecsFormat f){
+        switch(f){
+            case VecsFormat::BVECS: case VecsFormat::U8BIN: return VecsType::UINT8;
+            case VecsFormat::IVECS: case VecsFormat::IBIN:  return VecsType::INT32;
+            case VecsFormat::F16BIN:                        return VecsType::FLOAT16;
+            default:                                        return VecsType::FLOAT32;
+        }
+    }
+
+    size_t size_of(VecsType t){
+        switch(t){
+            case VecsType::UINT8:   return 1;
+            case VecsType::FLOAT16: return 2;
+            default:                return 4;
+        }
+    }
+
+    uint32_t read_u32(const char* p){
+        uint32_t v;
+        memcpy(&v , p , sizeof(v));
+        return v;
+    }
 }
 
-Dataset load_bin(const string &path){
-    Dataset ds;
+VecsFile::VecsFile(const string& path , VecsFormat format , vdb::MapOptions opts) : path_(path) {
+    if(format == VecsFormat::AUTO) format = format_of(path);
+
+    type_ = type_of(format);
+    elem_ = size_of(type_);
+    row_header_ = format == VecsFormat::FVECS || format == VecsFormat::BVECS || format == VecsFormat::IVECS;
+
+    // a row-per-record file with no rows is empty on disk, which cannot
+    // be mapped; it is still a valid dataset of 0 vectors
+    struct stat st;
+    if(stat(path.c_str() , &st) == 0 && st.st_size == 0){
+        if(!row_header_) throw runtime_error("truncated vector file " + path);
+        return;
+    }
+
+    file_ = vdb::MappedFile::open(path , opts);
+    const char* p = file_->data();
+    const size_t size = file_->size();
+
+    if(row_header_){
+        // every row repeats dim; the first fixes the stride, the others
+        // are checked as they are converted
+        if(size < sizeof(uint32_t)) throw runtime_error("truncated vector file " + path);
+        dim_ = read_u32(p);
+        stride_ = sizeof(uint32_t) + dim_ * elem_;
+        if(dim_ == 0 || size % stride_ != 0) throw runtime_error("bad row size in " + path);
+        n_ = size / stride_;
+        base_ = p + sizeof(uint32_t);
+    }else{
+        if(size < 2 * sizeof(uint32_t)) throw runtime_error("truncated vector file " + path);
+        n_ = read_u32(p);
+        dim_ = read_u32(p + sizeof(uint32_t));
+        stride_ = dim_ * elem_;
+        if(dim_ == 0 || n_ > (size - 2 * sizeof(uint32_t)) / stride_) throw runtime_error("truncated vector file " + path);
+        base_ = p + 2 * sizeof(uint32_t);
+    }
+}
+
+void VecsFile::to_float(size_t begin , size_t count , float* out , int threads) const {
+    if(type_ == VecsType::INT32) throw runtime_error("integer vector file " + path_ + " read as float");
+    if(begin > n_ || count > n_ - begin) throw out_of_range("rows past the end of " + path_);
 
-    ifstream ifs(path , ios::binary);
-    if(!ifs) throw runtime_error("failed to open " + path);
+    const size_t dim = dim_;
+    const int nt = threads > 0 ? threads : vdb::max_threads();
+    bool bad = false;
 
-    u_int32_t n , dim;
-    ifs.read(reinterpret_cast<char*>(&n) , sizeof(n));
-    ifs.read(reinterpret_cast<char*>(&dim) , sizeof(dim));
+    #pragma omp parallel for schedule(static) num_threads(nt) if(count * dim >= PARALLEL_MIN) reduction(||:bad)
+    for(size_t i = 0 ; i<count ; ++i){
+        const char* src = static_cast<const char*>(row(begin + i));
+        float* dst = out + i * dim;
 
-    ds.n = n;
-    ds.dim = dim;
+        if(row_header_ && read_u32(src - sizeof(uint32_t)) != dim) bad = true;
 
-    ds.data.resize(static_cast<size_t>(n) * dim);
-    ifs.read(reinterpret_cast<char*>(ds.data.data()) , sizeof(float)*ds.data.size());
+        switch(type_){
+            case VecsType::FLOAT32:
+                memcpy(dst , src , dim * sizeof(float));
+                break;
+            case VecsType::UINT8: {
+                const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+                for(size_t d = 0 ; d<dim ; ++d) dst[d] = static_cast<float>(s[d]);
+                break;
+            }
+            case VecsType::FLOAT16:
+                for(size_t d = 0 ; d<dim ; ++d){
+                    uint16_t h;
+                    memcpy(&h , src + 2*d , sizeof(h));
+                    dst[d] = vdb::half_to_float(h);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(bad) throw runtime_error("inconsistent dim in " + path_);
+}
+
+void VecsFile::to_int(size_t begin , size_t count , int32_t* out) const {
+    if(type_ != VecsType::INT32) throw runtime_error("vector file " + path_ + " read as integers");
+    if(begin > n_ || count > n_ - begin) throw out_of_range("rows past the end of " + path_);
+
+    bool bad = false;
+    for(size_t i = 0 ; i<count ; ++i){
+        const char* src = static_cast<const char*>(row(begin + i));
+        if(row_header_ && read_u32(src - sizeof(uint32_t)) != dim_) bad = true;
+        memcpy(out + i * dim_ , src , dim_ * sizeof(int32_t));
+    }
+
+    if(bad) throw runtime_error("inconsistent dim in " + path_);
+}
+
+static Dataset load_as(const string &path , VecsFormat format){
+    VecsFile f(path , format);
+
+    Dataset ds;
+    ds.n = f.n();
+    ds.dim = f.dim();
+    ds.data.resize(ds.n * ds.dim);
+    f.to_float(0 , ds.n , ds.data.data());
+    return ds;
+}
+
+Dataset load_vectors(const string &path) {return load_as(path , VecsFormat::AUTO);}
+Dataset load_fvecs(const string &path) {return load_as(path , VecsFormat::FVECS);}
+Dataset load_bvecs(const string &path) {return load_as(path , VecsFormat::BVECS);}
+Dataset load_bin(const string &path) {return load_as(path , VecsFormat::FBIN);}
+
+IntDataset load_ivecs(const string &path){
+    VecsFile f(path , VecsFormat::IVECS);
+
+    IntDataset ds;
+    ds.n = f.n();
+    ds.dim = f.dim();
+    ds.data.resize(ds.n * ds.dim);
+    f.to_int(0 , ds.n , ds.data.data());
     return ds;
-}
\ No newline at end of file
+}
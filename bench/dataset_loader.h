@@ -3,7 +3,13 @@ using namespace std;
 
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <memory>
 #include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../storage/mmap.h"
 
 struct Dataset {
     size_t n = 0;
@@ -11,6 +17,115 @@ struct Dataset {
     vector<float> data;
 };
 
+// Integer rows, e.g. the ground-truth neighbour ids of an .ivecs file.
+struct IntDataset {
+    size_t n = 0;
+    size_t dim = 0;
+    vector<int32_t> data;
+};
+
+enum class VecsFormat {
+    AUTO,      // from the file extension
+    FVECS,
+    BVECS,
+    IVECS,
+    FBIN,
+    U8BIN,
+    IBIN,
+    F16BIN
+};
+
+enum class VecsType {
+    FLOAT32,
+    UINT8,
+    INT32,
+    FLOAT16
+};
+
+// A vector file mapped read-only, without reading or copying it:
+//
+//   .fvecs / .bvecs / .ivecs         every row is int32 dim + dim elements
+//   .fbin / .bin / .u8bin / .ibin    uint32 n , uint32 dim , then n x dim
+//   .f16bin                          elements (float32 / uint8 / int32 / fp16)
+//
+// (.bin is read as .fbin; pass a VecsFormat for other names.)
+//
+// Rows are exposed in place as a strided view. A headerless float32 file
+// (.fbin) is already an n x dim row-major array that add_batch() can
+// take directly; the other formats are converted to float in parallel,
+// either all at once or chunk by chunk for files larger than RAM. The
+// mapping is advised SEQUENTIAL, so the kernel reads ahead and can drop
+// pages behind a chunked pass. Throws runtime_error on a bad file.
+class VecsFile {
+    public:
+        explicit VecsFile(const string& path , VecsFormat format = VecsFormat::AUTO ,
+                          vdb::MapOptions opts = {false , vdb::MapAdvice::SEQUENTIAL});
+
+        size_t n() const {return n_;}
+        size_t dim() const {return dim_;}
+        VecsType type() const {return type_;}
+        size_t elem_size() const {return elem_;}
+
+        // Bytes from one row to the next.
+        size_t stride() const {return stride_;}
+
+        // First element of row i (past the per-row header of *vecs files).
+        const void* row(size_t i) const {return base_ + i * stride_;}
+
+        // The whole file as one n x dim float array when it is a float32
+        // file without row headers; nullptr otherwise.
+        const float* floats() const {
+            return type_ == VecsType::FLOAT32 && stride_ == dim_ * sizeof(float) ? reinterpret_cast<const float*>(base_) : nullptr;
+        }
+
+        // Converts rows [begin , begin + count) to float into out (count x dim),
+        // on up to threads threads (0 = all). *vecs row headers are checked
+        // against dim on the way.
+        void to_float(size_t begin , size_t count , float* out , int threads = 0) const;
+
+        // Same for integer files (.ivecs , .ibin).
+        void to_int(size_t begin , size_t count , int32_t* out) const;
+
+        // Calls fn(rows , begin , count) for consecutive chunks of at most
+        // chunk_rows of the first max_rows rows, rows being count x dim
+        // floats. Contiguous float32 files are passed through from the
+        // mapping; others go through one reused conversion buffer, so
+        // memory stays at one chunk. chunk_rows must be positive.
+        template<typename F>
+        void for_each_chunk(size_t chunk_rows , F fn , size_t max_rows = SIZE_MAX) const {
+            if(chunk_rows == 0) throw invalid_argument("for_each_chunk: chunk_rows must be positive");
+            const size_t n = min(n_ , max_rows);
+            const float* direct = floats();
+            vector<float> buf(direct ? 0 : min(chunk_rows , n) * dim_);
+
+            for(size_t b = 0 ; b<n ; b += chunk_rows){
+                const size_t cnt = min(chunk_rows , n - b);
+                if(direct){
+                    fn(direct + b * dim_ , b , cnt);
+                }else{
+                    to_float(b , cnt , buf.data());
+                    fn(static_cast<const float*>(buf.data()) , b , cnt);
+                }
+            }
+        }
+
+    private:
+        string path_;
+        shared_ptr<const vdb::MappedFile> file_;
+        const char* base_ = nullptr;
+        size_t n_ = 0;
+        size_t dim_ = 0;
+        size_t elem_ = 0;
+        size_t stride_ = 0;
+        bool row_header_ = false;
+        VecsType type_ = VecsType::FLOAT32;
+};
+
+// Whole-file loads into owned memory: one allocation, parallel
+// conversion, format picked by extension as for VecsFile.
+Dataset load_vectors(const string &path);
 Dataset load_fvecs(const string &path);
+Dataset load_bvecs(const string &path);
 Dataset load_bin(const string &path);
-// Dataset load_csv(const string &path);
\ No newline at end of file
+IntDataset load_ivecs(const string &path);
+// Dataset load_csv(const string &path);
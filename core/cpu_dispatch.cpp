@@ -0,0 +1,182 @@
+#include "cpu_dispatch.h"
+#include "distance.h"
+#include "simd.h"
+
+#ifdef VDB_X86
+#include <cpuid.h>
+#endif
+
+namespace vdb {
+
+    namespace {
+
+#ifdef VDB_X86
+        unsigned long long read_xcr0(){
+            unsigned int eax , edx;
+            __asm__ volatile("xgetbv" : "=a"(eax) , "=d"(edx) : "c"(0));
+            return (static_cast<unsigned long long>(edx) << 32) | eax;
+        }
+#endif
+
+        // One-to-many wrappers for levels without a fused multi-row kernel.
+        template<pair_kernel_t K>
+        void batch_from_pair(const float* query , const float* base , size_t n , size_t stride , size_t dim , float* out){
+            for(size_t i = 0 ; i<n ; ++i) out[i] = K(query , base + i*stride , dim);
+        }
+
+        template<pair_kernel_t K>
+        void gather_from_pair(const float* query , const float* const* rows , size_t n , size_t dim , float* out){
+            for(size_t i = 0 ; i<n ; ++i) out[i] = K(query , rows[i] , dim);
+        }
+
+#ifdef VDB_X86
+        // VPOPCNTQ is not part of the AVX512 level; without it the
+        // vpshufb-based AVX2 popcount is the fastest Hamming kernel.
+        void hamming_avx512_or_avx2(const uint8_t* query , const uint8_t* codes , size_t n , size_t code_size , float* out){
+            static const hamming_kernel_t k = has_avx512_popcnt() ? hamming_avx512 : hamming_avx2;
+            k(query , codes , n , code_size , out);
+        }
+#endif
+
+        const DistanceKernels SCALAR_KERNELS = {
+            SimdLevel::SCALAR , l2_scalar , inner_product_scalar , cosine_scalar ,
+            l2_soa_scalar , inner_product_soa_scalar ,
+            batch_from_pair<l2_scalar> , batch_from_pair<inner_product_scalar> ,
+            gather_from_pair<l2_scalar> , gather_from_pair<inner_product_scalar> ,
+            inner_product_tile_scalar , pq_adc_scalar , pq_fastscan_scalar ,
+            l2_bounded_scalar ,
+            sq8_l2_scalar , sq8_inner_product_scalar ,
+            fp16_l2_scalar , fp16_inner_product_scalar ,
+            bf16_l2_scalar , bf16_inner_product_scalar ,
+            hamming_scalar
+        };
+
+#ifdef VDB_X86
+        const DistanceKernels SSE4_KERNELS = {
+            SimdLevel::SSE4 , l2_sse4 , inner_product_sse4 , cosine_sse4 ,
+            l2_sse4_soa , inner_product_sse4_soa ,
+            batch_from_pair<l2_sse4> , batch_from_pair<inner_product_sse4> ,
+            gather_from_pair<l2_sse4> , gather_from_pair<inner_product_sse4> ,
+            inner_product_tile_scalar , pq_adc_scalar , pq_fastscan_sse4 ,
+            l2_bounded_sse4 ,
+            sq8_l2_scalar , sq8_inner_product_scalar ,
+            fp16_l2_scalar , fp16_inner_product_scalar ,
+            bf16_l2_scalar , bf16_inner_product_scalar ,
+            hamming_scalar
+        };
+
+        const DistanceKernels AVX2_KERNELS = {
+            SimdLevel::AVX2 , l2_avx2 , inner_product_avx2 , cosine_avx2 ,
+            l2_avx2_soa , inner_product_avx2_soa ,
+            l2_batch_avx2 , inner_product_batch_avx2 ,
+            l2_gather_avx2 , inner_product_gather_avx2 ,
+            inner_product_tile_avx2 , pq_adc_avx2 , pq_fastscan_avx2 ,
+            l2_bounded_avx2 ,
+            sq8_l2_avx2 , sq8_inner_product_avx2 ,
+            fp16_l2_avx2 , fp16_inner_product_avx2 ,
+            bf16_l2_avx2 , bf16_inner_product_avx2 ,
+            hamming_avx2
+        };
+
+        // A block is 8 lanes wide, so the 256-bit SoA/tile kernels are already
+        // the best fit; a 512-bit gather fetches no more table entries per
+        // cycle than two 256-bit ones, so ADC stays on AVX2 as well. The
+        // 512-bit byte shuffle needs AVX512BW, so fast scan stays too.
+        const DistanceKernels AVX512_KERNELS = {
+            SimdLevel::AVX512 , l2_avx512 , inner_product_avx512 , cosine_avx512 ,
+            l2_avx2_soa , inner_product_avx2_soa ,
+            l2_batch_avx512 , inner_product_batch_avx512 ,
+            l2_gather_avx512 , inner_product_gather_avx512 ,
+            inner_product_tile_avx2 , pq_adc_avx2 , pq_fastscan_avx2 ,
+            l2_bounded_avx512 ,
+            sq8_l2_avx512 , sq8_inner_product_avx512 ,
+            fp16_l2_avx512 , fp16_inner_product_avx512 ,
+            bf16_l2_avx512 , bf16_inner_product_avx512 ,
+            hamming_avx512_or_avx2
+        };
+#endif
+    }
+
+    SimdLevel detect_simd_level(){
+#ifdef VDB_X86
+        unsigned int eax , ebx , ecx , edx;
+        if(!__get_cpuid(1 , &eax , &ebx , &ecx , &edx)) return SimdLevel::SCALAR;
+
+        const bool sse41   = ecx & (1u << 19);
+        const bool fma     = ecx & (1u << 12);
+        const bool osxsave = ecx & (1u << 27);
+        const bool avx     = ecx & (1u << 28);
+        const bool f16c    = ecx & (1u << 29);
+        const bool popcnt  = ecx & (1u << 23);
+
+        if(!sse41) return SimdLevel::SCALAR;
+        if(!(osxsave && avx && fma && f16c && popcnt)) return SimdLevel::SSE4;
+
+        // The OS must save the YMM (bits 1-2) and, for AVX-512, the
+        // opmask/ZMM state (bits 5-7) on context switches.
+        unsigned long long xcr0 = read_xcr0();
+        if((xcr0 & 0x6) != 0x6) return SimdLevel::SSE4;
+
+        if(!__get_cpuid_count(7 , 0 , &eax , &ebx , &ecx , &edx)) return SimdLevel::SSE4;
+
+        const bool avx2    = ebx & (1u << 5);
+        const bool avx512f = ebx & (1u << 16);
+
+        if(!avx2) return SimdLevel::SSE4;
+        if(avx512f && (xcr0 & 0xE6) == 0xE6) return SimdLevel::AVX512;
+
+        return SimdLevel::AVX2;
+#else
+        return SimdLevel::SCALAR;
+#endif
+    }
+
+    bool has_avx512_popcnt(){
+#ifdef VDB_X86
+        unsigned int eax , ebx , ecx , edx;
+        if(detect_simd_level() < SimdLevel::AVX512) return false;
+        if(!__get_cpuid_count(7 , 0 , &eax , &ebx , &ecx , &edx)) return false;
+        return ecx & (1u << 14);
+#else
+        return false;
+#endif
+    }
+
+    const DistanceKernels& best_kernels(){
+        static const DistanceKernels& best = kernels_for(detect_simd_level());
+        return best;
+    }
+
+    const DistanceKernels& kernels_for(SimdLevel level){
+        static const SimdLevel supported = detect_simd_level();
+        if(level > supported) level = supported;
+
+        switch(level){
+#ifdef VDB_X86
+            case SimdLevel::AVX512: return AVX512_KERNELS;
+            case SimdLevel::AVX2:   return AVX2_KERNELS;
+            case SimdLevel::SSE4:   return SSE4_KERNELS;
+#endif
+            default:                return SCALAR_KERNELS;
+        }
+    }
+
+    const DistanceKernels& kernels_for(DistanceType type){
+        switch(type){
+            case DistanceType::L2_SCALAR: return kernels_for(SimdLevel::SCALAR);
+            case DistanceType::L2_SSE4:   return kernels_for(SimdLevel::SSE4);
+            case DistanceType::L2_AVX2:   return kernels_for(SimdLevel::AVX2);
+            case DistanceType::L2_AVX512: return kernels_for(SimdLevel::AVX512);
+            default:                      return best_kernels();
+        }
+    }
+
+    const char* simd_level_name(SimdLevel level){
+        switch(level){
+            case SimdLevel::SSE4:   return "sse4";
+            case SimdLevel::AVX2:   return "avx2";
+            case SimdLevel::AVX512: return "avx512";
+            default:                return "scalar";
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace vdb{
+
+    enum class SimdLevel{
+        SCALAR,
+        SSE4,
+        AVX2,   // AVX2 + FMA
+        AVX512  // AVX-512F
+    };
+
+    using pair_kernel_t = float (*)(const float* a , const float* b , size_t dim);
+    using soa_kernel_t  = void (*)(const float* block , const float* query , size_t dim , float* out);
+    using batch_kernel_t = void (*)(const float* query , const float* base , size_t n , size_t stride , size_t dim , float* out);
+
+    // One-to-many over scattered rows: out[i] = distance(query , rows[i]).
+    using gather_kernel_t = void (*)(const float* query , const float* const* rows , size_t n , size_t dim , float* out);
+
+    // Early-abandon L2: the running sum is compared with bound every
+    // L2_ABANDON_STEP dims and returned as soon as it exceeds it. The result
+    // is the exact distance (same as the level's l2) when it is <= bound,
+    // and some partial sum > bound otherwise.
+    constexpr size_t L2_ABANDON_STEP = 128;
+    using bounded_kernel_t = float (*)(const float* a , const float* b , size_t dim , float bound);
+
+    // GEMM micro-kernel: inner products of TILE_QUERIES queries against nb
+    // packed VectorBlock blocks; out[r*ld + j] for query r and row j.
+    constexpr size_t TILE_QUERIES = 4;
+    using tile_kernel_t = void (*)(const float* const* queries , const float* blocks , size_t nb , size_t dim , float* out , size_t ld);
+
+    // PQ asymmetric distance: out[i] = sum_m table[m*PQ_KSUB + codes[i*M + m]]
+    // for n codes of M bytes each (see ProductQuantizer).
+    constexpr size_t PQ_KSUB = 256;
+    using adc_kernel_t = void (*)(const float* table , const uint8_t* codes , size_t n , size_t M , float* out);
+
+    // 4-bit PQ fast scan: raw uint16 table sums for nb blocks of
+    // PQ_FASTSCAN_BLOCK codes laid out as in ProductQuantizer::pack_fastscan;
+    // lut holds npairs x 32 quantized entries, out gets nb x 32 sums.
+    constexpr size_t PQ_FASTSCAN_BLOCK = 32;
+    using fastscan_kernel_t = void (*)(const uint8_t* lut , const uint8_t* packed , size_t nb , size_t npairs , uint16_t* out);
+
+    // Scans over compressed rows (see VectorEncoding): n rows of dim codes
+    // back to back, widened to float in registers.
+    //   sq8 l2            out[i] = sum_d weight[d] * (query[d] - code[i][d])^2
+    //   sq8 inner product out[i] = sum_d query[d] * code[i][d]   (weight unused)
+    // with the query and weights already moved into code space (see
+    // ScalarQuantizer), and for fp16 / bf16 the plain L2 / inner product.
+    using sq8_kernel_t = void (*)(const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    using half_kernel_t = void (*)(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+
+    // Hamming distance of a bit code to n codes of code_size bytes each,
+    // back to back: out[i] = popcount(query ^ code[i]).
+    using hamming_kernel_t = void (*)(const uint8_t* query , const uint8_t* codes , size_t n , size_t code_size , float* out);
+
+    // One entry per ISA level; every index resolves its table once per
+    // call and then only goes through these pointers.
+    struct DistanceKernels{
+        SimdLevel level;
+        pair_kernel_t l2;
+        pair_kernel_t inner_product;
+        pair_kernel_t cosine;
+        soa_kernel_t l2_soa;
+        soa_kernel_t inner_product_soa;
+        batch_kernel_t l2_batch;
+        batch_kernel_t inner_product_batch;
+        gather_kernel_t l2_gather;
+        gather_kernel_t inner_product_gather;
+        tile_kernel_t inner_product_tile;
+        adc_kernel_t pq_adc;
+        fastscan_kernel_t pq_fastscan;
+        bounded_kernel_t l2_bounded;
+        sq8_kernel_t sq8_l2;
+        sq8_kernel_t sq8_inner_product;
+        half_kernel_t fp16_l2;
+        half_kernel_t fp16_inner_product;
+        half_kernel_t bf16_l2;
+        half_kernel_t bf16_inner_product;
+        hamming_kernel_t hamming;
+    };
+
+    // Highest level supported by both the CPU (cpuid) and the OS (xgetbv).
+    SimdLevel detect_simd_level();
+
+    // AVX512_VPOPCNTDQ on top of the AVX512 level (picks the Hamming kernel).
+    bool has_avx512_popcnt();
+
+    // Table for the detected level, resolved once on first use.
+    const DistanceKernels& best_kernels();
+
+    // Table for an explicit level; levels the CPU lacks fall back to best_kernels().
+    const DistanceKernels& kernels_for(SimdLevel level);
+
+    // Maps SearchConfig::distance to a table; AUTO means best_kernels().
+    const DistanceKernels& kernels_for(DistanceType type);
+
+    const char* simd_level_name(SimdLevel level);
+}
@@ -1,15 +1,36 @@
 #include "distance.h"
+#include "vector_block.h"
+#include "half.h"
 #include <cassert>
+#include <cstring>
+#include <limits>
+#include <algorithm>
 
 using namespace std;
 
 namespace vdb {
-    dist_t l2_distance (const Vector& a, const Vector& b){
+    dist_t l2_distance (VectorView a, VectorView b){
         assert (a.dim == b.dim);
 
+        return l2_scalar(a.raw() , b.raw() , a.dim);
+    }
+
+    dist_t l2_distance(VectorView a , VectorView b , dist_t bound){
+        assert (a.dim == b.dim);
+
+        return l2_bounded_scalar(a.raw() , b.raw() , a.dim , bound);
+    }
+
+    dist_t cosine_distance(VectorView a, VectorView b){
+        assert (a.dim == b.dim);
+
+        return cosine_scalar(a.raw() , b.raw() , a.dim);
+    }
+
+    float l2_scalar(const float* a , const float* b , size_t dim){
         float sum = 0.0f;
-        for(dim_t i = 0; i<a.dim ; ++i){
-            float d = (a.data[i] - b.data[i]);
+        for(size_t i = 0; i<dim ; ++i){
+            float d = (a[i] - b[i]);
 
             sum += d*d;
         }
@@ -17,21 +38,284 @@ namespace vdb {
         return sum;
     }
 
-    dist_t cosine_distance(const Vector& a, const Vector& b){
-        assert (a.dim == b.dim);
+    float l2_bounded_scalar(const float* a , const float* b , size_t dim , float bound){
+        float sum = 0.0f;
+        for(size_t i = 0 ; i<dim ; ){
+            const size_t end = min(dim , i + L2_ABANDON_STEP);
+            for(; i<end ; ++i){
+                float d = (a[i] - b[i]);
+                sum += d*d;
+            }
+            if(sum > bound) break;
+        }
+        return sum;
+    }
+
+    float inner_product_scalar(const float* a , const float* b , size_t dim){
+        float dot = 0.0f;
+        for(size_t i = 0 ; i<dim ; ++i) dot += a[i] * b[i];
+
+        return dot;
+    }
 
+    float cosine_scalar(const float* a , const float* b , size_t dim){
         float dot = 0.0f;
         float na = 0.0f;
         float nb = 0.0f;
 
-        for(dim_t i = 0 ; i<a.dim ; ++i){
-            dot += a.data[i] * b.data[i];
-            na += a.data[i] * a.data[i];
-            nb += b.data[i] * b.data[i];
+        for(size_t i = 0 ; i<dim ; ++i){
+            dot += a[i] * b[i];
+            na += a[i] * a[i];
+            nb += b[i] * b[i];
         }
 
         if (na == 0.0f || nb == 0.0f) return 1.0f;
 
         return 1.0f - (dot / (sqrt(na) * sqrt(nb)));
     }
-}
\ No newline at end of file
+
+    void l2_soa_scalar(const float* block , const float* query , dim_t dim , dist_t* out){
+        constexpr size_t L = VectorBlock::LANES;
+
+        float acc[L] = {};
+        for(dim_t d = 0 ; d<dim ; ++d){
+            const float* lane = block + d*L;
+            for(size_t j = 0 ; j<L ; ++j){
+                float diff = lane[j] - query[d];
+                acc[j] += diff*diff;
+            }
+        }
+
+        for(size_t j = 0 ; j<L ; ++j) out[j] = acc[j];
+    }
+
+    void inner_product_soa_scalar(const float* block , const float* query , dim_t dim , dist_t* out){
+        constexpr size_t L = VectorBlock::LANES;
+
+        float acc[L] = {};
+        for(dim_t d = 0 ; d<dim ; ++d){
+            const float* lane = block + d*L;
+            for(size_t j = 0 ; j<L ; ++j) acc[j] += lane[j] * query[d];
+        }
+
+        for(size_t j = 0 ; j<L ; ++j) out[j] = acc[j];
+    }
+
+    void inner_product_tile_scalar(const float* const* queries , const float* blocks , size_t nb , size_t dim , float* out , size_t ld){
+        constexpr size_t L = VectorBlock::LANES;
+
+        for(size_t r = 0 ; r<TILE_QUERIES ; ++r){
+            for(size_t b = 0 ; b<nb ; ++b) inner_product_soa_scalar(blocks + b*dim*L , queries[r] , dim , out + r*ld + b*L);
+        }
+    }
+
+    void pq_adc_scalar(const float* table , const uint8_t* codes , size_t n , size_t M , float* out){
+        for(size_t i = 0 ; i<n ; ++i){
+            const uint8_t* c = codes + i*M;
+
+            float s0 = 0.0f , s1 = 0.0f , s2 = 0.0f , s3 = 0.0f;
+            size_t m = 0;
+            for(; m + 4<=M ; m += 4){
+                s0 += table[(m    )*PQ_KSUB + c[m    ]];
+                s1 += table[(m + 1)*PQ_KSUB + c[m + 1]];
+                s2 += table[(m + 2)*PQ_KSUB + c[m + 2]];
+                s3 += table[(m + 3)*PQ_KSUB + c[m + 3]];
+            }
+            for(; m<M ; ++m) s0 += table[m*PQ_KSUB + c[m]];
+
+            out[i] = (s0 + s1) + (s2 + s3);
+        }
+    }
+
+    void pq_fastscan_scalar(const uint8_t* lut , const uint8_t* packed , size_t nb , size_t npairs , uint16_t* out){
+        constexpr size_t B = PQ_FASTSCAN_BLOCK;
+
+        for(size_t b = 0 ; b<nb ; ++b){
+            uint16_t* o = out + b*B;
+            fill(o , o + B , 0);
+
+            // each 16-byte half is one sub-quantizer: low nibbles for
+            // codes 0..15 of the block, high nibbles for codes 16..31
+            const uint8_t* c = packed + b*npairs*32;
+            for(size_t h = 0 ; h<2*npairs ; ++h){
+                const uint8_t* t = lut + h*16;
+                for(size_t j = 0 ; j<16 ; ++j){
+                    o[j]      += t[c[h*16 + j] & 15];
+                    o[j + 16] += t[c[h*16 + j] >> 4];
+                }
+            }
+        }
+    }
+
+    void sq8_l2_scalar(const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out){
+        for(size_t i = 0 ; i<n ; ++i){
+            const uint8_t* c = codes + i*dim;
+            float sum = 0.0f;
+            for(size_t d = 0 ; d<dim ; ++d){
+                float diff = query[d] - c[d];
+                sum += weight[d] * diff * diff;
+            }
+            out[i] = sum;
+        }
+    }
+
+    void sq8_inner_product_scalar(const float* query , const float* , const uint8_t* codes , size_t n , size_t dim , float* out){
+        for(size_t i = 0 ; i<n ; ++i){
+            const uint8_t* c = codes + i*dim;
+            float dot = 0.0f;
+            for(size_t d = 0 ; d<dim ; ++d) dot += query[d] * c[d];
+            out[i] = dot;
+        }
+    }
+
+    namespace {
+        template<float (*DECODE)(uint16_t)>
+        void half_l2(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out){
+            for(size_t i = 0 ; i<n ; ++i){
+                const uint16_t* c = codes + i*dim;
+                float sum = 0.0f;
+                for(size_t d = 0 ; d<dim ; ++d){
+                    float diff = query[d] - DECODE(c[d]);
+                    sum += diff * diff;
+                }
+                out[i] = sum;
+            }
+        }
+
+        template<float (*DECODE)(uint16_t)>
+        void half_inner_product(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out){
+            for(size_t i = 0 ; i<n ; ++i){
+                const uint16_t* c = codes + i*dim;
+                float dot = 0.0f;
+                for(size_t d = 0 ; d<dim ; ++d) dot += query[d] * DECODE(c[d]);
+                out[i] = dot;
+            }
+        }
+    }
+
+    void fp16_l2_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out){
+        half_l2<half_to_float>(query , codes , n , dim , out);
+    }
+
+    void fp16_inner_product_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out){
+        half_inner_product<half_to_float>(query , codes , n , dim , out);
+    }
+
+    void bf16_l2_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out){
+        half_l2<bf16_to_float>(query , codes , n , dim , out);
+    }
+
+    void bf16_inner_product_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out){
+        half_inner_product<bf16_to_float>(query , codes , n , dim , out);
+    }
+
+    void hamming_scalar(const uint8_t* query , const uint8_t* codes , size_t n , size_t code_size , float* out){
+        for(size_t i = 0 ; i<n ; ++i){
+            const uint8_t* c = codes + i*code_size;
+            size_t bits = 0 , b = 0;
+            for( ; b + 8<=code_size ; b += 8){
+                uint64_t x , y;
+                memcpy(&x , query + b , 8);
+                memcpy(&y , c + b , 8);
+                bits += __builtin_popcountll(x ^ y);
+            }
+            for( ; b<code_size ; ++b) bits += __builtin_popcount(query[b] ^ c[b]);
+            out[i] = static_cast<float>(bits);
+        }
+    }
+
+    float norm(const float* x , dim_t dim , const DistanceKernels& kern){
+        return sqrt(kern.inner_product(x , x , dim));
+    }
+
+    DistanceComputer::DistanceComputer(const float* query , dim_t dim , Metric metric , const DistanceKernels& kern) :
+        query_(query) , dim_(dim) , metric_(metric) , kern_(kern) ,
+        query_norm_(metric == Metric::COSINE ? norm(query , dim , kern) : 0.0f) {}
+
+    void DistanceComputer::distances(const float* base , size_t n , size_t stride , const float* norms , dist_t* out) const {
+        if(metric_ == Metric::L2){
+            kern_.l2_batch(query_ , base , n , stride , dim_ , out);
+            return;
+        }
+
+        if(metric_ == Metric::COSINE && !norms){
+            for(size_t i = 0 ; i<n ; ++i) out[i] = kern_.cosine(query_ , base + i*stride , dim_);
+            return;
+        }
+
+        kern_.inner_product_batch(query_ , base , n , stride , dim_ , out);
+        for(size_t i = 0 ; i<n ; ++i) out[i] = from_dot(out[i] , norms ? norms[i] : 0.0f);
+    }
+
+    void DistanceComputer::block_distances(const float* block , const float* norms , dist_t* out) const {
+        if(metric_ == Metric::L2){
+            kern_.l2_soa(block , query_ , dim_ , out);
+            return;
+        }
+
+        assert(metric_ != Metric::COSINE || norms);
+
+        kern_.inner_product_soa(block , query_ , dim_ , out);
+        for(size_t j = 0 ; j<VectorBlock::LANES ; ++j) out[j] = from_dot(out[j] , norms ? norms[j] : 0.0f);
+    }
+
+    void DistanceComputer::selected_distances(const float* base , size_t n , size_t stride , const float* norms ,
+                                              const uint8_t* keep , dist_t* out) const {
+        size_t kept = 0;
+        for(size_t i = 0 ; i<n ; ++i) kept += keep[i];
+
+        if(kept * 4 >= n){
+            distances(base , n , stride , norms , out);
+        }else{
+            for(size_t i = 0 ; i<n ; ++i){
+                if(keep[i]) out[i] = norms ? (*this)(base + i*stride , norms[i]) : (*this)(base + i*stride);
+            }
+        }
+
+        for(size_t i = 0 ; i<n ; ++i) if(!keep[i]) out[i] = numeric_limits<dist_t>::infinity();
+    }
+
+    size_t DistanceComputer::within(const float* base , size_t n , size_t stride , const float* norms , dist_t radius ,
+                                    uint32_t* hits , dist_t* dists) const {
+        size_t m = 0;
+
+        if(metric_ == Metric::L2){
+            for(size_t i = 0 ; i<n ; ++i){
+                dist_t d = kern_.l2_bounded(query_ , base + i*stride , dim_ , radius);
+                if(d < radius){
+                    hits[m] = static_cast<uint32_t>(i);
+                    dists[m++] = d;
+                }
+            }
+            return m;
+        }
+
+        // compacted in place: m never passes i
+        distances(base , n , stride , norms , dists);
+        for(size_t i = 0 ; i<n ; ++i){
+            if(dists[i] < radius){
+                hits[m] = static_cast<uint32_t>(i);
+                dists[m++] = dists[i];
+            }
+        }
+        return m;
+    }
+
+    dist_t DistanceComputer::operator()(const float* x) const {
+        if(metric_ == Metric::COSINE) return kern_.cosine(query_ , x , dim_);
+
+        return (*this)(x , 0.0f);
+    }
+
+    dist_t DistanceComputer::operator()(const float* x , float x_norm) const {
+        if(metric_ == Metric::L2) return kern_.l2(query_ , x , dim_);
+
+        return from_dot(kern_.inner_product(query_ , x , dim_) , x_norm);
+    }
+
+    void distances(const float* query , const float* base , size_t n , size_t stride , dim_t dim ,
+                   dist_t* out , Metric metric , DistanceType type){
+        DistanceComputer dc(query , dim , metric , kernels_for(type));
+        dc.distances(base , n , stride , nullptr , out);
+    }
+}
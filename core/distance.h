@@ -1,19 +1,102 @@
 #pragma once
 #include "vector.h"
 #include "simd.h"
+#include "cpu_dispatch.h"
 
 using namespace std;
 
 namespace vdb{
 
-    dist_t l2_distance(const Vector& a , const Vector& b);
-    dist_t cosine_distance(const Vector& a , const Vector& b);
+    // Vector converts implicitly, so these also take owning vectors.
+    dist_t l2_distance(VectorView a , VectorView b);
+    dist_t cosine_distance(VectorView a , VectorView b);
+
+    // Early-abandon form: exact when <= bound, otherwise a partial sum > bound.
+    dist_t l2_distance(VectorView a , VectorView b , dist_t bound);
+
+    // Portable kernels; the SCALAR entry of the dispatch table.
+    float l2_scalar(const float* a , const float* b , size_t dim);
+    float inner_product_scalar(const float* a , const float* b , size_t dim);
+    float cosine_scalar(const float* a , const float* b , size_t dim);
+
+    // Portable counterparts of the *_soa kernels: 8 results for one VectorBlock block.
+    void l2_soa_scalar(const float* block , const float* query , dim_t dim , dist_t* out);
+    void inner_product_soa_scalar(const float* block , const float* query , dim_t dim , dist_t* out);
+    void inner_product_tile_scalar(const float* const* queries , const float* blocks , size_t nb , size_t dim , float* out , size_t ld);
+    void pq_adc_scalar(const float* table , const uint8_t* codes , size_t n , size_t M , float* out);
+    void pq_fastscan_scalar(const uint8_t* lut , const uint8_t* packed , size_t nb , size_t npairs , uint16_t* out);
+
+    float l2_bounded_scalar(const float* a , const float* b , size_t dim , float bound);
+
+    // Compressed-row scans, see sq8_kernel_t / half_kernel_t.
+    void sq8_l2_scalar(const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    void sq8_inner_product_scalar(const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    void fp16_l2_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void fp16_inner_product_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void bf16_l2_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void bf16_inner_product_scalar(const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void hamming_scalar(const uint8_t* query , const uint8_t* codes , size_t n , size_t code_size , float* out);
+
+    float norm(const float* x , dim_t dim , const DistanceKernels& kern);
+
+    // Scores one query against many vectors under a Metric. The query norm
+    // is computed once here; callers that cache per-vector norms (see
+    // LinearScanIndex) pass them in so COSINE costs the same as a plain
+    // inner-product scan. Without norms COSINE falls back to kern.cosine.
+    class DistanceComputer{
+        public:
+            DistanceComputer(const float* query , dim_t dim , Metric metric , const DistanceKernels& kern);
+
+            // out[i] = distance(query , base + i*stride) for i < n.
+            void distances(const float* base , size_t n , size_t stride , const float* norms , dist_t* out) const;
+
+            // out[j] for the LANES vectors of one VectorBlock block; COSINE
+            // needs the block's LANES norms.
+            void block_distances(const float* block , const float* norms , dist_t* out) const;
+
+            // distances() for the rows with keep[i] set; the others get +inf,
+            // which no TopKCollector takes. A sparse selection is scored row
+            // by row, a dense one with the batched kernel.
+            void selected_distances(const float* base , size_t n , size_t stride , const float* norms ,
+                                    const uint8_t* keep , dist_t* out) const;
+
+            // Range form of distances(): writes the row indexes (< n) and
+            // distances of the rows with distance < radius to hits / dists
+            // (room for n each) and returns their count. Under L2 each row
+            // goes through the early-abandon kernel, so rows far outside the
+            // radius stop after a fraction of dim.
+            size_t within(const float* base , size_t n , size_t stride , const float* norms , dist_t radius ,
+                          uint32_t* hits , dist_t* dists) const;
+
+            dist_t operator()(const float* x) const;
+            dist_t operator()(const float* x , float x_norm) const;
+
+            float query_norm() const {return query_norm_;}
+
+        private:
+            // Turns a raw inner product into the metric's distance.
+            dist_t from_dot(float dot , float x_norm) const {
+                if(metric_ == Metric::INNER_PRODUCT) return -dot;
+                if(query_norm_ == 0.0f || x_norm == 0.0f) return 1.0f;
+                return 1.0f - dot / (query_norm_ * x_norm);
+            }
+
+            const float* query_;
+            dim_t dim_;
+            Metric metric_;
+            const DistanceKernels& kern_;
+            float query_norm_;
+    };
+
+    // Convenience one-shot form of DistanceComputer::distances.
+    void distances(const float* query , const float* base , size_t n , size_t stride , dim_t dim ,
+                   dist_t* out , Metric metric = Metric::L2 , DistanceType type = DistanceType::AUTO);
     
-    inline dist_t l2_dispatch(const Vector& a , const Vector& b , DistanceType type){
-        if(type == DistanceType::L2_AVX2){
-            return l2_avx2(a.raw() , b.raw() , a.dim);
-        }
+    inline dist_t l2_dispatch(VectorView a , VectorView b , DistanceType type){
+        return kernels_for(type).l2(a.raw() , b.raw() , a.dim);
+    }
 
-        return l2_distance(a , b);
+    inline void l2_soa_dispatch(const float* block , const float* query , dim_t dim , dist_t* out , DistanceType type){
+        kernels_for(type).l2_soa(block , query , dim , out);
     }
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace vdb{
+
+    // Conversions for the 16-bit encodings of VectorEncoding. Scalar;
+    // bulk decode happens inside the scan kernels (F16C / shifts).
+
+    // IEEE 754 binary16 -> binary32, exact for every input (subnormals,
+    // infinities and NaN included).
+    inline float half_to_float(uint16_t h){
+        const uint32_t sign = uint32_t(h & 0x8000) << 16;
+        uint32_t exp = (h >> 10) & 0x1f;
+        uint32_t man = h & 0x3ff;
+        uint32_t bits;
+
+        if(exp == 0x1f){
+            bits = sign | 0x7f800000 | (man << 13);            // inf / NaN
+        }else if(exp != 0){
+            bits = sign | ((exp + 112) << 23) | (man << 13);   // rebias 15 -> 127
+        }else if(man == 0){
+            bits = sign;                                       // +-0
+        }else{
+            // subnormal: shift the leading 1 into the implicit bit
+            exp = 113;
+            while(!(man & 0x400)){man <<= 1; --exp;}
+            bits = sign | (exp << 23) | ((man & 0x3ff) << 13);
+        }
+
+        float f;
+        memcpy(&f , &bits , sizeof(f));
+        return f;
+    }
+
+    // binary32 -> binary16, round to nearest even; out of range -> +-inf.
+    inline uint16_t float_to_half(float f){
+        uint32_t x;
+        memcpy(&x , &f , sizeof(x));
+        const uint32_t sign = (x >> 16) & 0x8000;
+        const uint32_t a = x & 0x7fffffff;
+
+        if(a >= 0x7f800000) return sign | 0x7c00 | (a > 0x7f800000 ? 0x200 : 0);   // inf / NaN
+        if(a >= 0x477ff000) return sign | 0x7c00;                                 // >= 65520 rounds to inf
+        if(a <= 0x33000000) return sign;                                          // <= 2^-25 rounds to 0
+
+        uint32_t h , rem , half;
+        if(a < 0x38800000){
+            // subnormal result: units of 2^-24
+            const uint32_t shift = 126 - (a >> 23);
+            const uint32_t m = (a & 0x7fffff) | 0x800000;
+            h = m >> shift;
+            rem = m & ((1u << shift) - 1);
+            half = 1u << (shift - 1);
+        }else{
+            h = (a - 0x38000000) >> 13;   // rebias 127 -> 15
+            rem = a & 0x1fff;
+            half = 0x1000;
+        }
+        if(rem > half || (rem == half && (h & 1))) ++h;   // a carry into the exponent is still correct
+        return static_cast<uint16_t>(sign | h);
+    }
+
+    // bfloat16 is the top half of a binary32.
+    inline float bf16_to_float(uint16_t h){
+        const uint32_t bits = uint32_t(h) << 16;
+        float f;
+        memcpy(&f , &bits , sizeof(f));
+        return f;
+    }
+
+    // binary32 -> bfloat16, round to nearest even; NaN stays NaN.
+    inline uint16_t float_to_bf16(float f){
+        uint32_t x;
+        memcpy(&x , &f , sizeof(x));
+        if((x & 0x7fffffff) > 0x7f800000) return static_cast<uint16_t>((x >> 16) | 0x40);
+        return static_cast<uint16_t>((x + 0x7fff + ((x >> 16) & 1)) >> 16);
+    }
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include "types.h"
+
+using namespace std;
+namespace vdb {
+
+    // Restricts a search to a subset of ids (tenant, language, time range
+    // ...). Scans call is_member() before scoring a vector, so a rejected
+    // one costs a single check. count() and members() are optional hints
+    // an index uses to pick a strategy: score the allowed ids directly
+    // when they are few, filter inline (and widen the search) otherwise.
+    class IDSelector{
+        public:
+            static constexpr size_t UNKNOWN = SIZE_MAX;
+
+            virtual ~IDSelector() = default;
+
+            virtual bool is_member(idx_t id) const = 0;
+
+            // Number of members among ids [0 , n), or UNKNOWN.
+            virtual size_t count(size_t) const {return UNKNOWN;}
+
+            // Appends the members among [0 , n) in ascending order; false
+            // when the selector cannot enumerate them cheaply.
+            virtual bool members(size_t , vector<idx_t>&) const {return false;}
+    };
+
+    // One bit per id.
+    class IDSelectorBitmap : public IDSelector{
+        public:
+            explicit IDSelectorBitmap(size_t n) : n_(n) , words_((n + 63) / 64 , 0) {}
+
+            void set(idx_t id){
+                uint64_t& w = words_[id >> 6];
+                const uint64_t bit = uint64_t(1) << (id & 63);
+                count_ += !(w & bit);
+                w |= bit;
+            }
+
+            void reset(idx_t id){
+                uint64_t& w = words_[id >> 6];
+                const uint64_t bit = uint64_t(1) << (id & 63);
+                count_ -= !!(w & bit);
+                w &= ~bit;
+            }
+
+            bool is_member(idx_t id) const override {
+                return id < n_ && (words_[id >> 6] >> (id & 63)) & 1;
+            }
+
+            size_t count(size_t n) const override {
+                if(n >= n_) return count_;
+                size_t c = 0;
+                for(size_t w = 0 ; w < n / 64 ; ++w) c += __builtin_popcountll(words_[w]);
+                if(n % 64) c += __builtin_popcountll(words_[n / 64] & ((uint64_t(1) << (n % 64)) - 1));
+                return c;
+            }
+
+            bool members(size_t n , vector<idx_t>& out) const override {
+                n = min(n , n_);
+                for(size_t w = 0 ; w < (n + 63) / 64 ; ++w){
+                    for(uint64_t bits = words_[w] ; bits ; bits &= bits - 1){
+                        const size_t id = w*64 + __builtin_ctzll(bits);
+                        if(id >= n) break;
+                        out.push_back(static_cast<idx_t>(id));
+                    }
+                }
+                return true;
+            }
+
+        private:
+            size_t n_;
+            size_t count_ = 0;
+            vector<uint64_t> words_;
+    };
+
+    // Ids in [lo , hi).
+    class IDSelectorRange : public IDSelector{
+        public:
+            IDSelectorRange(idx_t lo , idx_t hi) : lo_(lo) , hi_(hi) {}
+
+            bool is_member(idx_t id) const override {return id >= lo_ && id < hi_;}
+
+            size_t count(size_t n) const override {
+                const size_t hi = min<size_t>(hi_ , n);
+                return hi > lo_ ? hi - lo_ : 0;
+            }
+
+            bool members(size_t n , vector<idx_t>& out) const override {
+                const size_t hi = min<size_t>(hi_ , n);
+                for(size_t id = lo_ ; id < hi ; ++id) out.push_back(static_cast<idx_t>(id));
+                return true;
+            }
+
+        private:
+            idx_t lo_ , hi_;
+    };
+
+    // An explicit id list, kept sorted for binary-search membership.
+    class IDSelectorArray : public IDSelector{
+        public:
+            explicit IDSelectorArray(vector<idx_t> ids) : ids_(move(ids)) {
+                sort(ids_.begin() , ids_.end());
+                ids_.erase(unique(ids_.begin() , ids_.end()) , ids_.end());
+            }
+
+            bool is_member(idx_t id) const override {return binary_search(ids_.begin() , ids_.end() , id);}
+
+            size_t count(size_t n) const override {
+                return lower_bound(ids_.begin() , ids_.end() , n) - ids_.begin();
+            }
+
+            bool members(size_t n , vector<idx_t>& out) const override {
+                out.insert(out.end() , ids_.begin() , ids_.begin() + count(n));
+                return true;
+            }
+
+        private:
+            vector<idx_t> ids_;
+    };
+
+    // Deleted rows of a mutable index (see DynamicIndex): admits every id
+    // not marked dead, so as the selector of a scan a deleted row costs
+    // one bit test and is never scored. Grows with the index.
+    class Tombstones : public IDSelector{
+        public:
+            size_t size() const {return n_;}
+            size_t dead() const {return dead_;}
+
+            // New ids are live.
+            void resize(size_t n){
+                words_.resize((n + 63) / 64 , 0);
+                n_ = n;
+            }
+
+            // false when id already was dead
+            bool kill(idx_t id){
+                uint64_t& w = words_[id >> 6];
+                const uint64_t bit = uint64_t(1) << (id & 63);
+                if(w & bit) return false;
+                w |= bit;
+                dead_++;
+                return true;
+            }
+
+            bool is_dead(idx_t id) const {
+                return id < n_ && (words_[id >> 6] >> (id & 63)) & 1;
+            }
+
+            bool is_member(idx_t id) const override {return !is_dead(id);}
+
+            size_t count(size_t n) const override {
+                return n >= n_ ? n - dead_ : UNKNOWN;
+            }
+
+        private:
+            size_t n_ = 0;
+            size_t dead_ = 0;
+            vector<uint64_t> words_;
+    };
+
+    // Arbitrary predicate; neither counted nor enumerable.
+    class IDSelectorFunction : public IDSelector{
+        public:
+            explicit IDSelectorFunction(function<bool(idx_t)> fn) : fn_(move(fn)) {}
+
+            bool is_member(idx_t id) const override {return fn_(id);}
+
+        private:
+            function<bool(idx_t)> fn_;
+    };
+
+    // Fraction of ids [0 , n) the selector admits: exact when count() is
+    // known, otherwise estimated on a strided sample of ids.
+    inline double selectivity(const IDSelector& sel , size_t n){
+        constexpr size_t SAMPLE = 256;
+
+        if(n == 0) return 1.0;
+
+        const size_t c = sel.count(n);
+        if(c != IDSelector::UNKNOWN) return static_cast<double>(c) / n;
+
+        const size_t step = max<size_t>(1 , n / SAMPLE);
+        size_t hit = 0 , seen = 0;
+        for(size_t id = step / 2 ; id < n ; id += step , ++seen) hit += sel.is_member(static_cast<idx_t>(id));
+        return static_cast<double>(hit) / seen;
+    }
+
+    // A search width (nprobe , ef) scaled by 1 / selectivity, so a filtered
+    // search still meets about as many allowed candidates; capped at cap.
+    inline size_t filtered_width(size_t width , size_t cap , double sel){
+        if(sel >= 1.0) return width;
+        const double w = sel > 0.0 ? width / sel : static_cast<double>(cap);
+        return max(width , static_cast<size_t>(min(w , static_cast<double>(cap))));
+    }
+}
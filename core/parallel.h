@@ -0,0 +1,34 @@
+#pragma once
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "types.h"
+
+namespace vdb{
+
+    // OpenMP keeps its worker team alive between parallel regions, so
+    // every parallel loop in the library runs on the same persistent
+    // pool; these helpers only size it. Without OpenMP they report a
+    // single thread and the pragmas compile away.
+    inline int max_threads(){
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    inline int thread_id(){
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    // Team size for a parallel region under cfg (0 = all available).
+    inline int num_threads(const SearchConfig& cfg){
+        return cfg.num_threads > 0 ? cfg.num_threads : max_threads();
+    }
+}
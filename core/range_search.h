@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "types.h"
+#include "parallel.h"
+
+using namespace std;
+namespace vdb {
+
+    // Range (radius) search results for a batch of queries in CSR form:
+    // the hits of query q are ids / distances [lims[q] , lims[q+1]),
+    // closest first. Two flat arrays instead of one vector per query.
+    struct RangeSearchResult{
+        vector<size_t> lims{0};
+        vector<idx_t> ids;
+        vector<dist_t> distances;
+
+        size_t nq() const {return lims.size() - 1;}
+        size_t size(size_t q) const {return lims[q + 1] - lims[q];}
+
+        void append(const vector<pair<idx_t , dist_t>>& hits){
+            for(const auto& h : hits){
+                ids.push_back(h.first);
+                distances.push_back(h.second);
+            }
+            lims.push_back(ids.size());
+        }
+    };
+
+    // Sorts range hits closest first (ties by id, for stable output).
+    inline void sort_hits(vector<pair<idx_t , dist_t>>& hits){
+        sort(hits.begin() , hits.end() , [] (const pair<idx_t , dist_t>& a , const pair<idx_t , dist_t>& b) {
+            return a.second < b.second || (a.second == b.second && a.first < b.first);
+        });
+    }
+
+    // Runs one_query(q) -> vector<pair<idx_t , dist_t>> for q < nq and packs
+    // the hits. Under OPENMP_BATCH whole queries go to threads; other
+    // policies run the queries in order (OPENMP parallelizes inside each).
+    template<typename F>
+    RangeSearchResult range_search_batch(size_t nq , const SearchConfig& cfg , F one_query){
+        vector<vector<pair<idx_t , dist_t>>> hits(nq);
+
+        #pragma omp parallel for schedule(dynamic , 1) num_threads(num_threads(cfg)) if(cfg.exec == ExecPolicy::OPENMP_BATCH)
+        for(size_t q = 0 ; q<nq ; ++q) hits[q] = one_query(q);
+
+        RangeSearchResult res;
+        size_t total = 0;
+        for(const auto& h : hits) total += h.size();
+        res.lims.reserve(nq + 1);
+        res.ids.reserve(total);
+        res.distances.reserve(total);
+        for(const auto& h : hits) res.append(h);
+        return res;
+    }
+}
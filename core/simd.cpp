@@ -1,10 +1,187 @@
 #include "simd.h"
+
+#ifdef VDB_X86
 #include <immintrin.h>
-#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+#include "cpu_dispatch.h"
+#include "half.h"
 
 namespace vdb {
 
-float l2_avx2(const float* a, const float* b, size_t dim) {
+/* ---------------- SSE4 ---------------- */
+
+VDB_TARGET_SSE4 static inline float hsum_sse(__m128 v) {
+    __m128 sh = _mm_movehdup_ps(v);
+    __m128 s = _mm_add_ps(v, sh);
+    sh = _mm_movehl_ps(sh, s);
+    return _mm_cvtss_f32(_mm_add_ss(s, sh));
+}
+
+VDB_TARGET_SSE4 float l2_sse4(const float* a, const float* b, size_t dim) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 4 <= dim; i += 4) {
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        sum = _mm_add_ps(sum, _mm_mul_ps(diff, diff));
+    }
+
+    float res = hsum_sse(sum);
+    for (; i < dim; ++i) {
+        float d = a[i] - b[i];
+        res += d * d;
+    }
+
+    return res;
+}
+
+// Same accumulation order as l2_sse4; the partial sum is only peeked at.
+VDB_TARGET_SSE4 float l2_bounded_sse4(const float* a, const float* b, size_t dim, float bound) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+
+    while (i + 4 <= dim) {
+        const size_t end = std::min(dim & ~size_t(3), i + L2_ABANDON_STEP);
+        for (; i < end; i += 4) {
+            __m128 diff = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+            sum = _mm_add_ps(sum, _mm_mul_ps(diff, diff));
+        }
+        float partial = hsum_sse(sum);
+        if (partial > bound) return partial;
+    }
+
+    float res = hsum_sse(sum);
+    for (; i < dim; ++i) {
+        float d = a[i] - b[i];
+        res += d * d;
+    }
+
+    return res;
+}
+
+VDB_TARGET_SSE4 float inner_product_sse4(const float* a, const float* b, size_t dim) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 4 <= dim; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    float res = hsum_sse(sum);
+    for (; i < dim; ++i) res += a[i] * b[i];
+
+    return res;
+}
+
+VDB_TARGET_SSE4 float cosine_sse4(const float* a, const float* b, size_t dim) {
+    __m128 dot = _mm_setzero_ps();
+    __m128 na = _mm_setzero_ps();
+    __m128 nb = _mm_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 4 <= dim; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        dot = _mm_add_ps(dot, _mm_mul_ps(va, vb));
+        na = _mm_add_ps(na, _mm_mul_ps(va, va));
+        nb = _mm_add_ps(nb, _mm_mul_ps(vb, vb));
+    }
+
+    float d = hsum_sse(dot), sa = hsum_sse(na), sb = hsum_sse(nb);
+    for (; i < dim; ++i) {
+        d += a[i] * b[i];
+        sa += a[i] * a[i];
+        sb += b[i] * b[i];
+    }
+
+    if (sa == 0.0f || sb == 0.0f) return 1.0f;
+    return 1.0f - d / (std::sqrt(sa) * std::sqrt(sb));
+}
+
+VDB_TARGET_SSE4 void l2_sse4_soa(const float* block, const float* query, size_t dim, float* out) {
+    // Two 4-wide halves of the 8-lane block.
+    __m128 lo = _mm_setzero_ps();
+    __m128 hi = _mm_setzero_ps();
+
+    for (size_t d = 0; d < dim; ++d) {
+        __m128 q = _mm_set1_ps(query[d]);
+        __m128 dl = _mm_sub_ps(_mm_loadu_ps(block + d * 8), q);
+        __m128 dh = _mm_sub_ps(_mm_loadu_ps(block + d * 8 + 4), q);
+        lo = _mm_add_ps(lo, _mm_mul_ps(dl, dl));
+        hi = _mm_add_ps(hi, _mm_mul_ps(dh, dh));
+    }
+
+    _mm_storeu_ps(out, lo);
+    _mm_storeu_ps(out + 4, hi);
+}
+
+VDB_TARGET_SSE4 void inner_product_sse4_soa(const float* block, const float* query, size_t dim, float* out) {
+    __m128 lo = _mm_setzero_ps();
+    __m128 hi = _mm_setzero_ps();
+
+    for (size_t d = 0; d < dim; ++d) {
+        __m128 q = _mm_set1_ps(query[d]);
+        lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(block + d * 8), q));
+        hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(block + d * 8 + 4), q));
+    }
+
+    _mm_storeu_ps(out, lo);
+    _mm_storeu_ps(out + 4, hi);
+}
+
+// 4-bit PQ fast scan. pshufb looks up 16 table bytes per instruction, so
+// the quantized LUT of a sub-quantizer lives in a register and a 16-byte
+// load of packed codes scores 32 codes (low and high nibbles). Sums are
+// kept in uint16: even bytes accumulate in the low half of each 16-bit
+// lane (with the odd byte riding above it) and odd bytes are accumulated
+// separately via a shift, then subtracted out at the end of the block.
+VDB_TARGET_SSE4 void pq_fastscan_sse4(const uint8_t* lut, const uint8_t* packed, size_t nb, size_t npairs, uint16_t* out) {
+    const __m128i nib = _mm_set1_epi8(0x0F);
+
+    for (size_t b = 0; b < nb; ++b) {
+        const uint8_t* c = packed + b * npairs * 32;
+        __m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();   // codes 0..15
+        __m128i b0 = _mm_setzero_si128(), b1 = _mm_setzero_si128();   // codes 16..31
+
+        for (size_t h = 0; h < 2 * npairs; ++h) {
+            __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lut + h * 16));
+            __m128i cv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + h * 16));
+
+            __m128i lo = _mm_shuffle_epi8(t, _mm_and_si128(cv, nib));
+            __m128i hi = _mm_shuffle_epi8(t, _mm_and_si128(_mm_srli_epi16(cv, 4), nib));
+
+            a0 = _mm_add_epi16(a0, lo);
+            a1 = _mm_add_epi16(a1, _mm_srli_epi16(lo, 8));
+            b0 = _mm_add_epi16(b0, hi);
+            b1 = _mm_add_epi16(b1, _mm_srli_epi16(hi, 8));
+        }
+
+        // lane i: even sum = code 2i, odd sum = code 2i + 1
+        __m128i ae = _mm_sub_epi16(a0, _mm_slli_epi16(a1, 8));
+        __m128i be = _mm_sub_epi16(b0, _mm_slli_epi16(b1, 8));
+
+        __m128i* o = reinterpret_cast<__m128i*>(out + b * 32);
+        _mm_storeu_si128(o,     _mm_unpacklo_epi16(ae, a1));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(ae, a1));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(be, b1));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(be, b1));
+    }
+}
+
+/* ---------------- AVX2 + FMA ---------------- */
+
+VDB_TARGET_AVX2 static inline float hsum_avx(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 sh = _mm_movehdup_ps(s);
+    s = _mm_add_ps(s, sh);
+    sh = _mm_movehl_ps(sh, s);
+    return _mm_cvtss_f32(_mm_add_ss(s, sh));
+}
+
+VDB_TARGET_AVX2 float l2_avx2(const float* a, const float* b, size_t dim) {
     __m256 sum = _mm256_setzero_ps();
     size_t i = 0;
 
@@ -15,11 +192,31 @@ float l2_avx2(const float* a, const float* b, size_t dim) {
         sum = _mm256_fmadd_ps(diff, diff, sum);
     }
 
-    float tmp[8];
-    _mm256_storeu_ps(tmp, sum);
+    float res = hsum_avx(sum);
+
+    for (; i < dim; ++i) {
+        float d = a[i] - b[i];
+        res += d * d;
+    }
+
+    return res;
+}
+
+VDB_TARGET_AVX2 float l2_bounded_avx2(const float* a, const float* b, size_t dim, float bound) {
+    __m256 sum = _mm256_setzero_ps();
+    size_t i = 0;
 
-    float res = tmp[0] + tmp[1] + tmp[2] + tmp[3]
-              + tmp[4] + tmp[5] + tmp[6] + tmp[7];
+    while (i + 8 <= dim) {
+        const size_t end = std::min(dim & ~size_t(7), i + L2_ABANDON_STEP);
+        for (; i < end; i += 8) {
+            __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+            sum = _mm256_fmadd_ps(diff, diff, sum);
+        }
+        float partial = hsum_avx(sum);
+        if (partial > bound) return partial;
+    }
+
+    float res = hsum_avx(sum);
 
     for (; i < dim; ++i) {
         float d = a[i] - b[i];
@@ -29,31 +226,804 @@ float l2_avx2(const float* a, const float* b, size_t dim) {
     return res;
 }
 
-// float l2_avx2_soa(
-//     const float* const* soa,   // soa[dim][num_vectors]
-//     const float* query,        // AoS query vector
-//     size_t dim,
-//     size_t vec_base,            // starting vector index
-//     float* out_distances        // size >= 8
-// ) {
-//     __m256 acc = _mm256_setzero_ps();
+VDB_TARGET_AVX2 float inner_product_avx2(const float* a, const float* b, size_t dim) {
+    __m256 sum = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 8 <= dim; i += 8) {
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+    }
+
+    float res = hsum_avx(sum);
+    for (; i < dim; ++i) res += a[i] * b[i];
+
+    return res;
+}
+
+VDB_TARGET_AVX2 float cosine_avx2(const float* a, const float* b, size_t dim) {
+    __m256 dot = _mm256_setzero_ps();
+    __m256 na = _mm256_setzero_ps();
+    __m256 nb = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 8 <= dim; i += 8) {
+        __m256 va = _mm256_loadu_ps(a + i);
+        __m256 vb = _mm256_loadu_ps(b + i);
+        dot = _mm256_fmadd_ps(va, vb, dot);
+        na = _mm256_fmadd_ps(va, va, na);
+        nb = _mm256_fmadd_ps(vb, vb, nb);
+    }
+
+    float d = hsum_avx(dot), sa = hsum_avx(na), sb = hsum_avx(nb);
+    for (; i < dim; ++i) {
+        d += a[i] * b[i];
+        sa += a[i] * a[i];
+        sb += b[i] * b[i];
+    }
+
+    if (sa == 0.0f || sb == 0.0f) return 1.0f;
+    return 1.0f - d / (std::sqrt(sa) * std::sqrt(sb));
+}
+
+VDB_TARGET_AVX2 void l2_avx2_soa(
+    const float* block,        // block[dim][8], see VectorBlock
+    const float* query,        // AoS query vector
+    size_t dim,
+    float* out                 // size >= 8
+) {
+    // Four independent accumulators hide the FMA latency; each one
+    // covers every 4th dimension for all 8 vectors of the block.
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+
+    size_t d = 0;
+    for (; d + 4 <= dim; d += 4) {
+        const float* p = block + d * 8;
+
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(p),      _mm256_broadcast_ss(query + d));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(p + 8),  _mm256_broadcast_ss(query + d + 1));
+        __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(p + 16), _mm256_broadcast_ss(query + d + 2));
+        __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(p + 24), _mm256_broadcast_ss(query + d + 3));
+
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+    }
+
+    for (; d < dim; ++d) {
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(block + d * 8), _mm256_broadcast_ss(query + d));
+        acc0 = _mm256_fmadd_ps(diff, diff, acc0);
+    }
+
+    acc0 = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    _mm256_storeu_ps(out, acc0);
+}
+
+VDB_TARGET_AVX2 void inner_product_avx2_soa(const float* block, const float* query, size_t dim, float* out) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    size_t d = 0;
+    for (; d + 2 <= dim; d += 2) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(block + d * 8),     _mm256_broadcast_ss(query + d),     acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(block + d * 8 + 8), _mm256_broadcast_ss(query + d + 1), acc1);
+    }
+
+    if (d < dim) acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(block + d * 8), _mm256_broadcast_ss(query + d), acc0);
+
+    _mm256_storeu_ps(out, _mm256_add_ps(acc0, acc1));
+}
+
+// One-to-many kernels score 4 rows per pass so every query load feeds
+// four independent FMA chains.
+VDB_TARGET_AVX2 static inline void l2_rows4_avx2(const float* query, const float* x0, const float* x1, const float* x2, const float* x3, size_t dim, float* out) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+
+    size_t d = 0;
+    for (; d + 8 <= dim; d += 8) {
+        __m256 q = _mm256_loadu_ps(query + d);
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(x0 + d), q);
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(x1 + d), q);
+        __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(x2 + d), q);
+        __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(x3 + d), q);
+        a0 = _mm256_fmadd_ps(d0, d0, a0);
+        a1 = _mm256_fmadd_ps(d1, d1, a1);
+        a2 = _mm256_fmadd_ps(d2, d2, a2);
+        a3 = _mm256_fmadd_ps(d3, d3, a3);
+    }
+
+    float r0 = hsum_avx(a0), r1 = hsum_avx(a1), r2 = hsum_avx(a2), r3 = hsum_avx(a3);
+    for (; d < dim; ++d) {
+        float q = query[d];
+        r0 += (x0[d] - q) * (x0[d] - q);
+        r1 += (x1[d] - q) * (x1[d] - q);
+        r2 += (x2[d] - q) * (x2[d] - q);
+        r3 += (x3[d] - q) * (x3[d] - q);
+    }
+
+    out[0] = r0; out[1] = r1; out[2] = r2; out[3] = r3;
+}
+
+VDB_TARGET_AVX2 void l2_batch_avx2(const float* query, const float* base, size_t n, size_t stride, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float* x0 = base + i * stride;
+        l2_rows4_avx2(query, x0, x0 + stride, x0 + 2 * stride, x0 + 3 * stride, dim, out + i);
+    }
 
-//     for (size_t d = 0; d < dim; ++d) {
-//         // Load 8 values from the same dimension across 8 vectors
-//         __m256 v = _mm256_loadu_ps(&soa[d][vec_base]);
+    for (; i < n; ++i) out[i] = l2_avx2(query, base + i * stride, dim);
+}
 
-//         // Broadcast query[d]
-//         __m256 q = _mm256_broadcast_ss(&query[d]);
+VDB_TARGET_AVX2 void l2_gather_avx2(const float* query, const float* const* rows, size_t n, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) l2_rows4_avx2(query, rows[i], rows[i + 1], rows[i + 2], rows[i + 3], dim, out + i);
+    for (; i < n; ++i) out[i] = l2_avx2(query, rows[i], dim);
+}
+
+VDB_TARGET_AVX2 static inline void inner_product_rows4_avx2(const float* query, const float* x0, const float* x1, const float* x2, const float* x3, size_t dim, float* out) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
 
-//         __m256 diff = _mm256_sub_ps(v, q);
-//         acc = _mm256_fmadd_ps(diff, diff, acc);
-//     }
+    size_t d = 0;
+    for (; d + 8 <= dim; d += 8) {
+        __m256 q = _mm256_loadu_ps(query + d);
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + d), q, a0);
+        a1 = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + d), q, a1);
+        a2 = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + d), q, a2);
+        a3 = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + d), q, a3);
+    }
+
+    float r0 = hsum_avx(a0), r1 = hsum_avx(a1), r2 = hsum_avx(a2), r3 = hsum_avx(a3);
+    for (; d < dim; ++d) {
+        float q = query[d];
+        r0 += x0[d] * q;
+        r1 += x1[d] * q;
+        r2 += x2[d] * q;
+        r3 += x3[d] * q;
+    }
+
+    out[0] = r0; out[1] = r1; out[2] = r2; out[3] = r3;
+}
+
+VDB_TARGET_AVX2 void inner_product_batch_avx2(const float* query, const float* base, size_t n, size_t stride, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float* x0 = base + i * stride;
+        inner_product_rows4_avx2(query, x0, x0 + stride, x0 + 2 * stride, x0 + 3 * stride, dim, out + i);
+    }
+
+    for (; i < n; ++i) out[i] = inner_product_avx2(query, base + i * stride, dim);
+}
+
+VDB_TARGET_AVX2 void inner_product_gather_avx2(const float* query, const float* const* rows, size_t n, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) inner_product_rows4_avx2(query, rows[i], rows[i + 1], rows[i + 2], rows[i + 3], dim, out + i);
+    for (; i < n; ++i) out[i] = inner_product_avx2(query, rows[i], dim);
+}
 
-//     // Store 8 accumulated distances
-//     _mm256_storeu_ps(out_distances, acc);
+// GEMM-style micro-kernel: a 4 query x 16 row register tile (8
+// accumulators). Each step loads dimension d of two packed blocks once and
+// broadcasts q[d] of each query, so no horizontal sums are needed.
+VDB_TARGET_AVX2 void inner_product_tile_avx2(const float* const* queries, const float* blocks, size_t nb, size_t dim, float* out, size_t ld) {
+    const float* q0 = queries[0];
+    const float* q1 = queries[1];
+    const float* q2 = queries[2];
+    const float* q3 = queries[3];
 
-//     return 0.0f; // return value unused (kept for API symmetry)
-// }
+    size_t b = 0;
+    for (; b + 2 <= nb; b += 2) {
+        const float* x0 = blocks + b * dim * 8;
+        const float* x1 = x0 + dim * 8;
 
+        __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+        __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+        __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+        __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+
+        for (size_t d = 0; d < dim; ++d) {
+            __m256 v0 = _mm256_loadu_ps(x0 + d * 8);
+            __m256 v1 = _mm256_loadu_ps(x1 + d * 8);
+
+            __m256 a = _mm256_broadcast_ss(q0 + d);
+            c00 = _mm256_fmadd_ps(a, v0, c00);
+            c01 = _mm256_fmadd_ps(a, v1, c01);
+
+            a = _mm256_broadcast_ss(q1 + d);
+            c10 = _mm256_fmadd_ps(a, v0, c10);
+            c11 = _mm256_fmadd_ps(a, v1, c11);
+
+            a = _mm256_broadcast_ss(q2 + d);
+            c20 = _mm256_fmadd_ps(a, v0, c20);
+            c21 = _mm256_fmadd_ps(a, v1, c21);
+
+            a = _mm256_broadcast_ss(q3 + d);
+            c30 = _mm256_fmadd_ps(a, v0, c30);
+            c31 = _mm256_fmadd_ps(a, v1, c31);
+        }
+
+        float* o = out + b * 8;
+        _mm256_storeu_ps(o,              c00);
+        _mm256_storeu_ps(o + 8,          c01);
+        _mm256_storeu_ps(o + ld,         c10);
+        _mm256_storeu_ps(o + ld + 8,     c11);
+        _mm256_storeu_ps(o + 2 * ld,     c20);
+        _mm256_storeu_ps(o + 2 * ld + 8, c21);
+        _mm256_storeu_ps(o + 3 * ld,     c30);
+        _mm256_storeu_ps(o + 3 * ld + 8, c31);
+    }
+
+    for (; b < nb; ++b) {
+        const float* x0 = blocks + b * dim * 8;
+
+        __m256 c0 = _mm256_setzero_ps(), c1 = _mm256_setzero_ps();
+        __m256 c2 = _mm256_setzero_ps(), c3 = _mm256_setzero_ps();
+
+        for (size_t d = 0; d < dim; ++d) {
+            __m256 v0 = _mm256_loadu_ps(x0 + d * 8);
+            c0 = _mm256_fmadd_ps(_mm256_broadcast_ss(q0 + d), v0, c0);
+            c1 = _mm256_fmadd_ps(_mm256_broadcast_ss(q1 + d), v0, c1);
+            c2 = _mm256_fmadd_ps(_mm256_broadcast_ss(q2 + d), v0, c2);
+            c3 = _mm256_fmadd_ps(_mm256_broadcast_ss(q3 + d), v0, c3);
+        }
+
+        float* o = out + b * 8;
+        _mm256_storeu_ps(o,          c0);
+        _mm256_storeu_ps(o + ld,     c1);
+        _mm256_storeu_ps(o + 2 * ld, c2);
+        _mm256_storeu_ps(o + 3 * ld, c3);
+    }
+}
+
+// Sub-quantizers past the last full group of 8.
+static inline float pq_adc_tail(const float* table, const uint8_t* code, size_t from, size_t M) {
+    float s = 0.0f;
+    for (size_t m = from; m < M; ++m) s += table[m * PQ_KSUB + code[m]];
+    return s;
+}
+
+// One gather fetches the table entries of 8 consecutive sub-quantizers
+// (lane j reads table[(m + j)*PQ_KSUB + code[m + j]]); four codes are summed
+// side by side to hide the gather latency and share one reduction.
+VDB_TARGET_AVX2 void pq_adc_avx2(const float* table, const uint8_t* codes, size_t n, size_t M, float* out) {
+    constexpr int K = static_cast<int>(PQ_KSUB);
+    const __m256i lane_off = _mm256_setr_epi32(0, K, 2 * K, 3 * K, 4 * K, 5 * K, 6 * K, 7 * K);
+    const size_t M8 = M & ~size_t(7);
+    if (M8 == 0) {
+        for (size_t i = 0; i < n; ++i) out[i] = pq_adc_tail(table, codes + i * M, 0, M);
+        return;
+    }
+
+    auto idx = [&](const uint8_t* c) VDB_TARGET_AVX2 {
+        return _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(c))), lane_off);
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const uint8_t* c0 = codes + i * M;
+        const uint8_t* c1 = c0 + M;
+        const uint8_t* c2 = c1 + M;
+        const uint8_t* c3 = c2 + M;
+
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+
+        for (size_t m = 0; m < M8; m += 8) {
+            const float* t = table + m * PQ_KSUB;
+            a0 = _mm256_add_ps(a0, _mm256_i32gather_ps(t, idx(c0 + m), 4));
+            a1 = _mm256_add_ps(a1, _mm256_i32gather_ps(t, idx(c1 + m), 4));
+            a2 = _mm256_add_ps(a2, _mm256_i32gather_ps(t, idx(c2 + m), 4));
+            a3 = _mm256_add_ps(a3, _mm256_i32gather_ps(t, idx(c3 + m), 4));
+        }
+
+        // [a0 a1 a2 a3] horizontal sums in one register
+        __m256 h = _mm256_hadd_ps(_mm256_hadd_ps(a0, a1), _mm256_hadd_ps(a2, a3));
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+        _mm_storeu_ps(out + i, s);
+
+        if (M8 < M) {
+            out[i]     += pq_adc_tail(table, c0, M8, M);
+            out[i + 1] += pq_adc_tail(table, c1, M8, M);
+            out[i + 2] += pq_adc_tail(table, c2, M8, M);
+            out[i + 3] += pq_adc_tail(table, c3, M8, M);
+        }
+    }
+
+    for (; i < n; ++i) {
+        const uint8_t* c = codes + i * M;
+        __m256 a = _mm256_setzero_ps();
+        for (size_t m = 0; m < M8; m += 8) a = _mm256_add_ps(a, _mm256_i32gather_ps(table + m * PQ_KSUB, idx(c + m), 4));
+        out[i] = hsum_avx(a) + pq_adc_tail(table, c, M8, M);
+    }
+}
+
+// Same scheme as pq_fastscan_sse4 with two sub-quantizers per register:
+// the low 128 bits hold sub-quantizer 2p, the high 128 bits 2p + 1, and
+// the two halves are added once per block.
+VDB_TARGET_AVX2 void pq_fastscan_avx2(const uint8_t* lut, const uint8_t* packed, size_t nb, size_t npairs, uint16_t* out) {
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+
+    for (size_t b = 0; b < nb; ++b) {
+        const uint8_t* c = packed + b * npairs * 32;
+        __m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();   // codes 0..15
+        __m256i b0 = _mm256_setzero_si256(), b1 = _mm256_setzero_si256();   // codes 16..31
+
+        for (size_t p = 0; p < npairs; ++p) {
+            __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lut + p * 32));
+            __m256i cv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + p * 32));
+
+            __m256i lo = _mm256_shuffle_epi8(t, _mm256_and_si256(cv, nib));
+            __m256i hi = _mm256_shuffle_epi8(t, _mm256_and_si256(_mm256_srli_epi16(cv, 4), nib));
+
+            a0 = _mm256_add_epi16(a0, lo);
+            a1 = _mm256_add_epi16(a1, _mm256_srli_epi16(lo, 8));
+            b0 = _mm256_add_epi16(b0, hi);
+            b1 = _mm256_add_epi16(b1, _mm256_srli_epi16(hi, 8));
+        }
+
+        __m256i ae = _mm256_sub_epi16(a0, _mm256_slli_epi16(a1, 8));
+        __m256i be = _mm256_sub_epi16(b0, _mm256_slli_epi16(b1, 8));
+
+        // fold the two sub-quantizer halves
+        __m128i ae4 = _mm_add_epi16(_mm256_castsi256_si128(ae), _mm256_extracti128_si256(ae, 1));
+        __m128i ao4 = _mm_add_epi16(_mm256_castsi256_si128(a1), _mm256_extracti128_si256(a1, 1));
+        __m128i be4 = _mm_add_epi16(_mm256_castsi256_si128(be), _mm256_extracti128_si256(be, 1));
+        __m128i bo4 = _mm_add_epi16(_mm256_castsi256_si128(b1), _mm256_extracti128_si256(b1, 1));
+
+        __m128i* o = reinterpret_cast<__m128i*>(out + b * 32);
+        _mm_storeu_si128(o,     _mm_unpacklo_epi16(ae4, ao4));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(ae4, ao4));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(be4, bo4));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(be4, bo4));
+    }
+}
+
+/* ---------------- compressed rows (VectorEncoding) ---------------- */
+
+// Code formats: widen 8 (AVX2) or 16 (AVX-512) codes to floats in
+// registers, or one code for the scalar tail.
+struct U8Codes {
+    using code_t = uint8_t;
+
+    VDB_TARGET_AVX2 static __m256 widen8(const uint8_t* p) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+    }
+
+    VDB_TARGET_AVX512 static __m512 widen16(const uint8_t* p) {
+        return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    }
+
+    static float one(uint8_t c) { return c; }
+};
+
+struct FP16Codes {
+    using code_t = uint16_t;
+
+    VDB_TARGET_AVX2 static __m256 widen8(const uint16_t* p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    VDB_TARGET_AVX512 static __m512 widen16(const uint16_t* p) {
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    }
+
+    static float one(uint16_t c) { return half_to_float(c); }
+};
+
+// bf16 is the top half of a float: zero-extend and shift into place.
+struct BF16Codes {
+    using code_t = uint16_t;
+
+    VDB_TARGET_AVX2 static __m256 widen8(const uint16_t* p) {
+        __m256i w = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(w, 16));
+    }
+
+    VDB_TARGET_AVX512 static __m512 widen16(const uint16_t* p) {
+        __m512i w = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(w, 16));
+    }
+
+    static float one(uint16_t c) { return bf16_to_float(c); }
+};
+
+// out[i] = sum_d w[d] (q[d] - x[d])^2 over the widened row, w = 1 when
+// weight is null; two accumulators hide the FMA latency.
+template <typename C>
+VDB_TARGET_AVX2 static void codes_l2_avx2(const float* query, const float* weight, const typename C::code_t* codes, size_t n, size_t dim, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const typename C::code_t* c = codes + i * dim;
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        size_t d = 0;
+
+        for (; d + 16 <= dim; d += 16) {
+            __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(query + d), C::widen8(c + d));
+            __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(query + d + 8), C::widen8(c + d + 8));
+            if (weight) {
+                s0 = _mm256_fmadd_ps(_mm256_mul_ps(d0, _mm256_loadu_ps(weight + d)), d0, s0);
+                s1 = _mm256_fmadd_ps(_mm256_mul_ps(d1, _mm256_loadu_ps(weight + d + 8)), d1, s1);
+            } else {
+                s0 = _mm256_fmadd_ps(d0, d0, s0);
+                s1 = _mm256_fmadd_ps(d1, d1, s1);
+            }
+        }
+
+        if (d + 8 <= dim) {
+            __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(query + d), C::widen8(c + d));
+            s0 = _mm256_fmadd_ps(weight ? _mm256_mul_ps(d0, _mm256_loadu_ps(weight + d)) : d0, d0, s0);
+            d += 8;
+        }
+
+        float res = hsum_avx(_mm256_add_ps(s0, s1));
+        for (; d < dim; ++d) {
+            float diff = query[d] - C::one(c[d]);
+            res += (weight ? weight[d] : 1.0f) * diff * diff;
+        }
+        out[i] = res;
+    }
+}
+
+template <typename C>
+VDB_TARGET_AVX2 static void codes_inner_product_avx2(const float* query, const typename C::code_t* codes, size_t n, size_t dim, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const typename C::code_t* c = codes + i * dim;
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        size_t d = 0;
+
+        for (; d + 16 <= dim; d += 16) {
+            s0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d), C::widen8(c + d), s0);
+            s1 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d + 8), C::widen8(c + d + 8), s1);
+        }
+
+        if (d + 8 <= dim) {
+            s0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d), C::widen8(c + d), s0);
+            d += 8;
+        }
+
+        float res = hsum_avx(_mm256_add_ps(s0, s1));
+        for (; d < dim; ++d) res += query[d] * C::one(c[d]);
+        out[i] = res;
+    }
+}
+
+VDB_TARGET_AVX2 void sq8_l2_avx2(const float* query, const float* weight, const uint8_t* codes, size_t n, size_t dim, float* out) {
+    codes_l2_avx2<U8Codes>(query, weight, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX2 void sq8_inner_product_avx2(const float* query, const float*, const uint8_t* codes, size_t n, size_t dim, float* out) {
+    codes_inner_product_avx2<U8Codes>(query, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX2 void fp16_l2_avx2(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_l2_avx2<FP16Codes>(query, nullptr, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX2 void fp16_inner_product_avx2(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_inner_product_avx2<FP16Codes>(query, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX2 void bf16_l2_avx2(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_l2_avx2<BF16Codes>(query, nullptr, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX2 void bf16_inner_product_avx2(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_inner_product_avx2<BF16Codes>(query, codes, n, dim, out);
+}
+
+// Bits differing in bytes [from, size): 64-bit words, then single bytes.
+VDB_TARGET_AVX2 static inline size_t hamming_tail(const uint8_t* a, const uint8_t* b, size_t from, size_t size) {
+    size_t bits = 0;
+    for (; from + 8 <= size; from += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + from, 8);
+        memcpy(&y, b + from, 8);
+        bits += __builtin_popcountll(x ^ y);
+    }
+    for (; from < size; ++from) bits += __builtin_popcount(a[from] ^ b[from]);
+    return bits;
+}
+
+// AVX2 has no vector popcount: each byte is counted with two 4-bit
+// lookups (vpshufb) and vpsadbw sums the byte counts per 64-bit lane.
+VDB_TARGET_AVX2 void hamming_avx2(const uint8_t* query, const uint8_t* codes, size_t n, size_t code_size, float* out) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    const size_t full = code_size & ~size_t(31);
+
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* c = codes + i * code_size;
+        __m256i acc = zero;
+
+        for (size_t b = 0; b < full; b += 32) {
+            __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(query + b)),
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + b)));
+            __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                          _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, zero));
+        }
+
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        out[i] = static_cast<float>(lanes[0] + lanes[1] + lanes[2] + lanes[3] + hamming_tail(query, c, full, code_size));
+    }
+}
+
+/* ---------------- AVX-512F ---------------- */
+
+// Tails are handled with a masked load instead of a scalar loop.
+VDB_TARGET_AVX512 static inline __mmask16 tail_mask(size_t rem) {
+    return static_cast<__mmask16>((1u << rem) - 1u);
+}
+
+VDB_TARGET_AVX512 float l2_avx512(const float* a, const float* b, size_t dim) {
+    __m512 sum = _mm512_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 16 <= dim; i += 16) {
+        __m512 diff = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        sum = _mm512_fmadd_ps(diff, diff, sum);
+    }
+
+    if (i < dim) {
+        __mmask16 m = tail_mask(dim - i);
+        __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i));
+        sum = _mm512_fmadd_ps(diff, diff, sum);
+    }
+
+    return _mm512_reduce_add_ps(sum);
+}
+
+VDB_TARGET_AVX512 float l2_bounded_avx512(const float* a, const float* b, size_t dim, float bound) {
+    __m512 sum = _mm512_setzero_ps();
+    size_t i = 0;
+
+    while (i + 16 <= dim) {
+        const size_t end = std::min(dim & ~size_t(15), i + L2_ABANDON_STEP);
+        for (; i < end; i += 16) {
+            __m512 diff = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+            sum = _mm512_fmadd_ps(diff, diff, sum);
+        }
+        float partial = _mm512_reduce_add_ps(sum);
+        if (partial > bound) return partial;
+    }
+
+    if (i < dim) {
+        __mmask16 m = tail_mask(dim - i);
+        __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i));
+        sum = _mm512_fmadd_ps(diff, diff, sum);
+    }
+
+    return _mm512_reduce_add_ps(sum);
+}
+
+VDB_TARGET_AVX512 float inner_product_avx512(const float* a, const float* b, size_t dim) {
+    __m512 sum = _mm512_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 16 <= dim; i += 16) {
+        sum = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum);
+    }
+
+    if (i < dim) {
+        __mmask16 m = tail_mask(dim - i);
+        sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), sum);
+    }
+
+    return _mm512_reduce_add_ps(sum);
+}
+
+VDB_TARGET_AVX512 float cosine_avx512(const float* a, const float* b, size_t dim) {
+    __m512 dot = _mm512_setzero_ps();
+    __m512 na = _mm512_setzero_ps();
+    __m512 nb = _mm512_setzero_ps();
+    size_t i = 0;
+
+    for (; i + 16 <= dim; i += 16) {
+        __m512 va = _mm512_loadu_ps(a + i);
+        __m512 vb = _mm512_loadu_ps(b + i);
+        dot = _mm512_fmadd_ps(va, vb, dot);
+        na = _mm512_fmadd_ps(va, va, na);
+        nb = _mm512_fmadd_ps(vb, vb, nb);
+    }
+
+    if (i < dim) {
+        __mmask16 m = tail_mask(dim - i);
+        __m512 va = _mm512_maskz_loadu_ps(m, a + i);
+        __m512 vb = _mm512_maskz_loadu_ps(m, b + i);
+        dot = _mm512_fmadd_ps(va, vb, dot);
+        na = _mm512_fmadd_ps(va, va, na);
+        nb = _mm512_fmadd_ps(vb, vb, nb);
+    }
+
+    float sa = _mm512_reduce_add_ps(na);
+    float sb = _mm512_reduce_add_ps(nb);
+    if (sa == 0.0f || sb == 0.0f) return 1.0f;
+
+    return 1.0f - _mm512_reduce_add_ps(dot) / (std::sqrt(sa) * std::sqrt(sb));
+}
+
+VDB_TARGET_AVX512 static inline void l2_rows4_avx512(const float* query, const float* x0, const float* x1, const float* x2, const float* x3, size_t dim, float* out) {
+    __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+    __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+
+    for (size_t d = 0; d < dim; d += 16) {
+        __mmask16 m = dim - d >= 16 ? static_cast<__mmask16>(0xFFFF) : tail_mask(dim - d);
+        __m512 q = _mm512_maskz_loadu_ps(m, query + d);
+        __m512 d0 = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x0 + d), q);
+        __m512 d1 = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x1 + d), q);
+        __m512 d2 = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x2 + d), q);
+        __m512 d3 = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, x3 + d), q);
+        a0 = _mm512_fmadd_ps(d0, d0, a0);
+        a1 = _mm512_fmadd_ps(d1, d1, a1);
+        a2 = _mm512_fmadd_ps(d2, d2, a2);
+        a3 = _mm512_fmadd_ps(d3, d3, a3);
+    }
+
+    out[0] = _mm512_reduce_add_ps(a0);
+    out[1] = _mm512_reduce_add_ps(a1);
+    out[2] = _mm512_reduce_add_ps(a2);
+    out[3] = _mm512_reduce_add_ps(a3);
+}
+
+VDB_TARGET_AVX512 void l2_batch_avx512(const float* query, const float* base, size_t n, size_t stride, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float* x0 = base + i * stride;
+        l2_rows4_avx512(query, x0, x0 + stride, x0 + 2 * stride, x0 + 3 * stride, dim, out + i);
+    }
+
+    for (; i < n; ++i) out[i] = l2_avx512(query, base + i * stride, dim);
+}
+
+VDB_TARGET_AVX512 void l2_gather_avx512(const float* query, const float* const* rows, size_t n, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) l2_rows4_avx512(query, rows[i], rows[i + 1], rows[i + 2], rows[i + 3], dim, out + i);
+    for (; i < n; ++i) out[i] = l2_avx512(query, rows[i], dim);
+}
+
+VDB_TARGET_AVX512 static inline void inner_product_rows4_avx512(const float* query, const float* x0, const float* x1, const float* x2, const float* x3, size_t dim, float* out) {
+    __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+    __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+
+    for (size_t d = 0; d < dim; d += 16) {
+        __mmask16 m = dim - d >= 16 ? static_cast<__mmask16>(0xFFFF) : tail_mask(dim - d);
+        __m512 q = _mm512_maskz_loadu_ps(m, query + d);
+        a0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x0 + d), q, a0);
+        a1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x1 + d), q, a1);
+        a2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x2 + d), q, a2);
+        a3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x3 + d), q, a3);
+    }
+
+    out[0] = _mm512_reduce_add_ps(a0);
+    out[1] = _mm512_reduce_add_ps(a1);
+    out[2] = _mm512_reduce_add_ps(a2);
+    out[3] = _mm512_reduce_add_ps(a3);
+}
+
+VDB_TARGET_AVX512 void inner_product_batch_avx512(const float* query, const float* base, size_t n, size_t stride, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float* x0 = base + i * stride;
+        inner_product_rows4_avx512(query, x0, x0 + stride, x0 + 2 * stride, x0 + 3 * stride, dim, out + i);
+    }
+
+    for (; i < n; ++i) out[i] = inner_product_avx512(query, base + i * stride, dim);
+}
+
+VDB_TARGET_AVX512 void inner_product_gather_avx512(const float* query, const float* const* rows, size_t n, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) inner_product_rows4_avx512(query, rows[i], rows[i + 1], rows[i + 2], rows[i + 3], dim, out + i);
+    for (; i < n; ++i) out[i] = inner_product_avx512(query, rows[i], dim);
+}
+
+
+// Same as the AVX2 forms, 16 codes per widening load; a remaining
+// group of 8 goes through the 256-bit path.
+template <typename C>
+VDB_TARGET_AVX512 static void codes_l2_avx512(const float* query, const float* weight, const typename C::code_t* codes, size_t n, size_t dim, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const typename C::code_t* c = codes + i * dim;
+        __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+        size_t d = 0;
+
+        for (; d + 32 <= dim; d += 32) {
+            __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(query + d), C::widen16(c + d));
+            __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(query + d + 16), C::widen16(c + d + 16));
+            if (weight) {
+                s0 = _mm512_fmadd_ps(_mm512_mul_ps(d0, _mm512_loadu_ps(weight + d)), d0, s0);
+                s1 = _mm512_fmadd_ps(_mm512_mul_ps(d1, _mm512_loadu_ps(weight + d + 16)), d1, s1);
+            } else {
+                s0 = _mm512_fmadd_ps(d0, d0, s0);
+                s1 = _mm512_fmadd_ps(d1, d1, s1);
+            }
+        }
+
+        if (d + 16 <= dim) {
+            __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(query + d), C::widen16(c + d));
+            s0 = _mm512_fmadd_ps(weight ? _mm512_mul_ps(d0, _mm512_loadu_ps(weight + d)) : d0, d0, s0);
+            d += 16;
+        }
+
+        float res = _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+        if (d < dim) {
+            codes_l2_avx2<C>(query + d, weight ? weight + d : nullptr, c + d, 1, dim - d, out + i);
+            res += out[i];
+        }
+        out[i] = res;
+    }
+}
+
+template <typename C>
+VDB_TARGET_AVX512 static void codes_inner_product_avx512(const float* query, const typename C::code_t* codes, size_t n, size_t dim, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const typename C::code_t* c = codes + i * dim;
+        __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+        size_t d = 0;
+
+        for (; d + 32 <= dim; d += 32) {
+            s0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + d), C::widen16(c + d), s0);
+            s1 = _mm512_fmadd_ps(_mm512_loadu_ps(query + d + 16), C::widen16(c + d + 16), s1);
+        }
+
+        if (d + 16 <= dim) {
+            s0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + d), C::widen16(c + d), s0);
+            d += 16;
+        }
+
+        float res = _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+        if (d < dim) {
+            codes_inner_product_avx2<C>(query + d, c + d, 1, dim - d, out + i);
+            res += out[i];
+        }
+        out[i] = res;
+    }
+}
+
+VDB_TARGET_AVX512 void sq8_l2_avx512(const float* query, const float* weight, const uint8_t* codes, size_t n, size_t dim, float* out) {
+    codes_l2_avx512<U8Codes>(query, weight, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX512 void sq8_inner_product_avx512(const float* query, const float*, const uint8_t* codes, size_t n, size_t dim, float* out) {
+    codes_inner_product_avx512<U8Codes>(query, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX512 void fp16_l2_avx512(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_l2_avx512<FP16Codes>(query, nullptr, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX512 void fp16_inner_product_avx512(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_inner_product_avx512<FP16Codes>(query, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX512 void bf16_l2_avx512(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_l2_avx512<BF16Codes>(query, nullptr, codes, n, dim, out);
+}
+
+VDB_TARGET_AVX512 void bf16_inner_product_avx512(const float* query, const uint16_t* codes, size_t n, size_t dim, float* out) {
+    codes_inner_product_avx512<BF16Codes>(query, codes, n, dim, out);
+}
+
+// One VPOPCNTQ per 64 bytes: a 1024-dim code is two xor + popcount steps.
+VDB_TARGET_AVX512_POPCNT void hamming_avx512(const uint8_t* query, const uint8_t* codes, size_t n, size_t code_size, float* out) {
+    const size_t full = code_size & ~size_t(63);
+
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* c = codes + i * code_size;
+        __m512i acc = _mm512_setzero_si512();
+
+        for (size_t b = 0; b < full; b += 64) {
+            __m512i x = _mm512_xor_si512(_mm512_loadu_si512(query + b), _mm512_loadu_si512(c + b));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+        }
+
+        out[i] = static_cast<float>(_mm512_reduce_add_epi64(acc) + hamming_tail(query, c, full, code_size));
+    }
+}
 
 }
+#endif
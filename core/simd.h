@@ -1,13 +1,89 @@
 #pragma once
-#include <immintrin.h>
 #include<cstddef>
+#include<cstdint>
+
+// Every kernel in simd.cpp carries its own target attribute, so the
+// library itself is built for the baseline ISA and the fastest variant
+// is picked at runtime (see cpu_dispatch.h).
+#if defined(__x86_64__) || defined(__i386__)
+    #define VDB_X86 1
+    #define VDB_TARGET_SSE4   __attribute__((target("sse4.1")))
+    #define VDB_TARGET_AVX2   __attribute__((target("avx2,fma,f16c,popcnt")))
+    #define VDB_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma,f16c,popcnt")))
+    // VPOPCNTQ is its own AVX-512 extension (Ice Lake , Zen 4 and later).
+    #define VDB_TARGET_AVX512_POPCNT __attribute__((target("avx512f,avx512vpopcntdq,avx2,fma,f16c,popcnt")))
+#endif
 
 namespace vdb{
 
+#ifdef VDB_X86
+    float l2_sse4 (const float* a , const float* b , size_t dim);
+    float l2_bounded_sse4 (const float* a , const float* b , size_t dim , float bound);
+    float inner_product_sse4 (const float* a , const float* b , size_t dim);
+    float cosine_sse4 (const float* a , const float* b , size_t dim);
+    void l2_sse4_soa (const float* block , const float* query , size_t dim , float* out);
+    void inner_product_sse4_soa (const float* block , const float* query , size_t dim , float* out);
+
+    // 4-bit PQ fast scan, see fastscan_kernel_t in cpu_dispatch.h.
+    void pq_fastscan_sse4 (const uint8_t* lut , const uint8_t* packed , size_t nb , size_t npairs , uint16_t* out);
+
     float l2_avx2 (const float* a , const float* b , size_t dim);
-    // FLOAT l2_avx2_soa (const float* const* soa,   // soa[dim][num_vectors]
-    // const float* query,        // AoS query vector
-    // size_t dim,
-    // size_t vec_base,            // starting vector index
-    // float* out_distances)
-}
\ No newline at end of file
+
+    // See bounded_kernel_t in cpu_dispatch.h.
+    float l2_bounded_avx2 (const float* a , const float* b , size_t dim , float bound);
+    float inner_product_avx2 (const float* a , const float* b , size_t dim);
+    float cosine_avx2 (const float* a , const float* b , size_t dim);
+
+    // Scores one VectorBlock block (LANES = 8 vectors stored as
+    // block[dim][8]) against an AoS query; writes 8 distances to out.
+    void l2_avx2_soa (const float* block ,
+                      const float* query ,
+                      size_t dim ,
+                      float* out);
+    void inner_product_avx2_soa (const float* block , const float* query , size_t dim , float* out);
+
+    // out[i] = distance(query , base + i*stride) for i < n.
+    void l2_batch_avx2 (const float* query , const float* base , size_t n , size_t stride , size_t dim , float* out);
+    void inner_product_batch_avx2 (const float* query , const float* base , size_t n , size_t stride , size_t dim , float* out);
+
+    // out[i] = distance(query , rows[i]) for i < n.
+    void l2_gather_avx2 (const float* query , const float* const* rows , size_t n , size_t dim , float* out);
+    void inner_product_gather_avx2 (const float* query , const float* const* rows , size_t n , size_t dim , float* out);
+
+    // 4 queries x packed blocks, see tile_kernel_t in cpu_dispatch.h.
+    void inner_product_tile_avx2 (const float* const* queries , const float* blocks , size_t nb , size_t dim , float* out , size_t ld);
+
+    // PQ lookup-table scan, see adc_kernel_t in cpu_dispatch.h.
+    void pq_adc_avx2 (const float* table , const uint8_t* codes , size_t n , size_t M , float* out);
+    void pq_fastscan_avx2 (const uint8_t* lut , const uint8_t* packed , size_t nb , size_t npairs , uint16_t* out);
+
+    // Compressed-row scans, see sq8_kernel_t / half_kernel_t in cpu_dispatch.h.
+    void sq8_l2_avx2 (const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    void sq8_inner_product_avx2 (const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    void fp16_l2_avx2 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void fp16_inner_product_avx2 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void bf16_l2_avx2 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void bf16_inner_product_avx2 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+
+    // See hamming_kernel_t in cpu_dispatch.h.
+    void hamming_avx2 (const uint8_t* query , const uint8_t* codes , size_t n , size_t code_size , float* out);
+
+    float l2_avx512 (const float* a , const float* b , size_t dim);
+    float l2_bounded_avx512 (const float* a , const float* b , size_t dim , float bound);
+    float inner_product_avx512 (const float* a , const float* b , size_t dim);
+    float cosine_avx512 (const float* a , const float* b , size_t dim);
+    void l2_batch_avx512 (const float* query , const float* base , size_t n , size_t stride , size_t dim , float* out);
+    void inner_product_batch_avx512 (const float* query , const float* base , size_t n , size_t stride , size_t dim , float* out);
+    void l2_gather_avx512 (const float* query , const float* const* rows , size_t n , size_t dim , float* out);
+    void inner_product_gather_avx512 (const float* query , const float* const* rows , size_t n , size_t dim , float* out);
+    void sq8_l2_avx512 (const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    void sq8_inner_product_avx512 (const float* query , const float* weight , const uint8_t* codes , size_t n , size_t dim , float* out);
+    void fp16_l2_avx512 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void fp16_inner_product_avx512 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void bf16_l2_avx512 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+    void bf16_inner_product_avx512 (const float* query , const uint16_t* codes , size_t n , size_t dim , float* out);
+
+    // Needs AVX512_VPOPCNTDQ on top of the AVX512 level, see has_avx512_popcnt().
+    void hamming_avx512 (const uint8_t* query , const uint8_t* codes , size_t n , size_t code_size , float* out);
+#endif
+}
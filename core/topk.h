@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "types.h"
+
+using namespace std;
+namespace vdb {
+
+    // Streaming top-k: a bounded max-heap of the k closest (dist , id)
+    // pairs seen so far. Memory is O(k) and allocated once, so scans can
+    // feed it millions of candidates without touching the allocator.
+    // Not thread-safe; parallel scans keep one collector per thread and
+    // merge() them at the end.
+    class TopKCollector{
+        public:
+            explicit TopKCollector(size_t k) : k_(k) {heap_.reserve(k);}
+
+            size_t k() const {return k_;}
+            size_t size() const {return heap_.size();}
+            bool full() const {return heap_.size() == k_;}
+
+            // Distance a candidate has to beat to enter; +inf until k are held.
+            dist_t threshold() const {
+                return full() && k_ > 0 ? heap_.front().first : numeric_limits<dist_t>::infinity();
+            }
+
+            bool push(idx_t id , dist_t d){
+                if(heap_.size() < k_){
+                    heap_.emplace_back(d , id);
+                    push_heap(heap_.begin() , heap_.end());
+                    return true;
+                }
+
+                if(k_ == 0 || !(d < heap_.front().first)) return false;
+
+                pop_heap(heap_.begin() , heap_.end());
+                heap_.back() = {d , id};
+                push_heap(heap_.begin() , heap_.end());
+                return true;
+            }
+
+            // Candidates ids base .. base+n-1 with distances dists[0..n).
+            // Most of them fail the threshold test, which is a single
+            // well-predicted compare per candidate. +inf is never taken,
+            // so filtered scans mark rejected candidates with it.
+            void push_range(const dist_t* dists , size_t n , idx_t base){
+                dist_t thr = threshold();
+                for(size_t i = 0 ; i<n ; ++i){
+                    if(dists[i] < thr){
+                        push(base + static_cast<idx_t>(i) , dists[i]);
+                        thr = threshold();
+                    }
+                }
+            }
+
+            // Same as push_range for candidates with arbitrary ids, e.g. the
+            // id array of an inverted list.
+            void push_ids(const dist_t* dists , const idx_t* ids , size_t n){
+                dist_t thr = threshold();
+                for(size_t i = 0 ; i<n ; ++i){
+                    if(dists[i] < thr){
+                        push(ids[i] , dists[i]);
+                        thr = threshold();
+                    }
+                }
+            }
+
+            void merge(const TopKCollector& other){
+                for(const auto& e : other.heap_) push(e.second , e.first);
+            }
+
+            void clear() {heap_.clear();}
+
+            // Drains the collector into (id , dist) pairs, closest first.
+            vector<pair<idx_t , dist_t>> sorted_results(){
+                vector<pair<idx_t , dist_t>> out(heap_.size());
+                sort_heap(heap_.begin() , heap_.end());
+                for(size_t i = 0 ; i<heap_.size() ; ++i) out[i] = {heap_[i].second , heap_[i].first};
+                heap_.clear();
+                return out;
+            }
+
+        private:
+            size_t k_;
+            vector<pair<dist_t , idx_t>> heap_;
+    };
+}
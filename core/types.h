@@ -8,14 +8,34 @@ namespace vdb{
     using idx_t = uint32_t;
     using dist_t = float;
 
+    // Not a row: marks a dropped row in a compaction remap.
+    constexpr idx_t NO_ID = UINT32_MAX;
+
+    // Selects the kernel ISA. AUTO resolves to the fastest one the CPU
+    // supports at runtime (see cpu_dispatch.h); an explicit level the
+    // CPU lacks is clamped to the best available one.
     enum class DistanceType {
         L2_SCALAR,
-        L2_AVX2
+        L2_SSE4,
+        L2_AVX2,
+        L2_AVX512,
+        AUTO
+    };
+
+    // Every metric is reported as a distance (smaller is closer):
+    //   L2            -> squared euclidean distance
+    //   INNER_PRODUCT -> -<q , x>
+    //   COSINE        -> 1 - <q , x> / (|q| |x|)
+    enum class Metric{
+        L2,
+        INNER_PRODUCT,
+        COSINE
     };
 
     enum class ExecPolicy{
         SINGLE_THREAD,
-        OPENMP
+        OPENMP,        // intra-query: one query's scan is split across threads
+        OPENMP_BATCH   // inter-query: batch_search hands whole queries to threads
     };
 
     enum class LayoutType{
@@ -23,9 +43,25 @@ namespace vdb{
         SOA  // structures of array
     };
 
+    // How a LinearScanIndex stores its vectors. The compressed encodings
+    // are scanned by kernels that widen codes to float in registers, so
+    // a scan reads 2x (FP16 , BF16) or 4x (SQ8) fewer bytes than FP32.
+    // BINARY scans 32x fewer bytes by Hamming distance and re-ranks a
+    // shortlist against fp32 rows it keeps alongside the bits.
+    enum class VectorEncoding{
+        FP32,
+        SQ8,    // 1 byte per dim, uniform on a per-dimension [min , max] learned at train()
+        FP16,
+        BF16,
+        BINARY  // 1 bit per dim, set when above the per-dimension mean learned at train()
+    };
+
     struct SearchConfig {
-        DistanceType distance = DistanceType::L2_SCALAR;
+        DistanceType distance = DistanceType::AUTO;
+        Metric metric = Metric::L2;
         ExecPolicy exec = ExecPolicy::SINGLE_THREAD;
         LayoutType layout = LayoutType::AOS;
+        int num_threads = 0;   // team size for OPENMP policies, 0 = all cores
+        VectorEncoding encoding = VectorEncoding::FP32;   // LinearScanIndex only
     };
 }
\ No newline at end of file
@@ -23,4 +23,18 @@ namespace vdb{
 
         void normalize();
     };
-}
\ No newline at end of file
+
+    // Non-owning span over one vector's floats, e.g. a row of a
+    // VectorStore. Cheap to copy; the owner must outlive it.
+    struct VectorView{
+        const float* data;
+        dim_t dim;
+
+        VectorView() : data(nullptr) , dim(0) {}
+        VectorView(const float* d , dim_t n) : data(d) , dim(n) {}
+        VectorView(const Vector& v) : data(v.raw()) , dim(v.dim) {}
+
+        const float* raw() const {return data;}
+        float operator[](size_t i) const {return data[i];}
+    };
+}
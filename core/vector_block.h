@@ -1,19 +1,212 @@
 #pragma once 
 #include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <memory>
 #include "types.h"
+#include "vector.h"
 
 using namespace std;
 namespace vdb {
 
+    // Allocator handing out ALIGN-byte aligned storage, so std::vector
+    // buffers start on a cache line and full-width SIMD loads never split.
+    template<typename T , size_t ALIGN = 64>
+    struct AlignedAllocator{
+        using value_type = T;
+
+        template<typename U> struct rebind {using other = AlignedAllocator<U , ALIGN>;};
+
+        AlignedAllocator() = default;
+        template<typename U> AlignedAllocator(const AlignedAllocator<U , ALIGN>&) {}
+
+        T* allocate(size_t n){
+            size_t bytes = (n * sizeof(T) + ALIGN - 1) / ALIGN * ALIGN;
+            void* p = aligned_alloc(ALIGN , bytes);
+            if(!p) throw bad_alloc();
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p , size_t) {free(p);}
+
+        template<typename U> bool operator==(const AlignedAllocator<U , ALIGN>&) const {return true;}
+        template<typename U> bool operator!=(const AlignedAllocator<U , ALIGN>&) const {return false;}
+    };
+
+    template<typename T>
+    using aligned_vector = vector<T , AlignedAllocator<T>>;
+
+    // Array that either owns an aligned_vector or borrows a read-only range
+    // of someone else's memory (a memory-mapped index file, see
+    // storage/serialization.h). keep holds the lender alive for as long as
+    // the view exists. Reads never copy; the first mutating call copies a
+    // borrowed range into owned storage, so a mapped index stays usable
+    // for add() and rebuilds. Offers the subset of std::vector the indexes use.
+    template<typename T>
+    class MappedVector{
+        public:
+            MappedVector() = default;
+            explicit MappedVector(size_t n , const T& v = T()) : own_(n , v) {}
+
+            static MappedVector borrow(const T* p , size_t n , shared_ptr<const void> keep){
+                MappedVector m;
+                m.ext_ = p;
+                m.ext_n_ = n;
+                m.keep_ = move(keep);
+                return m;
+            }
+
+            bool borrowed() const {return ext_ != nullptr;}
+
+            size_t size() const {return ext_ ? ext_n_ : own_.size();}
+            bool empty() const {return size() == 0;}
+            size_t capacity() const {return ext_ ? ext_n_ : own_.capacity();}
+
+            const T* data() const {return ext_ ? ext_ : own_.data();}
+            T* data() {materialize(); return own_.data();}
+
+            const T& operator[](size_t i) const {return data()[i];}
+            T& operator[](size_t i) {return data()[i];}
+
+            const T* begin() const {return data();}
+            const T* end() const {return data() + size();}
+            T* begin() {return data();}
+            T* end() {return data() + size();}
+
+            const T& back() const {return data()[size() - 1];}
+
+            void reserve(size_t n) {materialize(); own_.reserve(n);}
+            void resize(size_t n) {materialize(); own_.resize(n);}
+            void resize(size_t n , const T& v) {materialize(); own_.resize(n , v);}
+            void assign(size_t n , const T& v) {release(); own_.assign(n , v);}
+            template<typename It> void assign(It first , It last) {release(); own_.assign(first , last);}
+            void push_back(const T& v) {materialize(); own_.push_back(v);}
+
+            template<typename It> void insert(const T* pos , It first , It last){
+                const size_t at = pos - data();
+                materialize();
+                own_.insert(own_.begin() + at , first , last);
+            }
+
+            void clear() {release(); own_.clear();}
+
+        private:
+            void materialize(){
+                if(!ext_) return;
+                own_.assign(ext_ , ext_ + ext_n_);
+                release();
+            }
+
+            void release(){
+                ext_ = nullptr;
+                ext_n_ = 0;
+                keep_.reset();
+            }
+
+            aligned_vector<T> own_;
+            const T* ext_ = nullptr;
+            size_t ext_n_ = 0;
+            shared_ptr<const void> keep_;
+    };
+
+    // Blocked SoA layout: vectors are grouped in blocks of LANES and
+    // interleaved by dimension, i.e. data[block][d][lane]. One 8-wide
+    // load then reads dimension d of LANES different vectors, which is
+    // what the l2_*_soa kernels consume. Unused lanes of the tail block
+    // are kept at zero.
     struct VectorBlock{
+        static constexpr size_t LANES = 8;
+
         dim_t dim;
         size_t size;
-        vector<float> data;
+        MappedVector<float> data;
+
+        VectorBlock(size_t n, dim_t d) : dim(d) , size(n) , data(blocks_for(n) * d * LANES) {}
 
-        VectorBlock(size_t n, dim_t d) : dim(d) , size(n) , data(n*d) {}
+        static size_t blocks_for(size_t n) { return (n + LANES - 1) / LANES; }
 
-        float* row(size_t i){
-            return data.data() + i*dim;
+        size_t num_blocks() const { return blocks_for(size); }
+
+        float* block(size_t b){
+            return data.data() + b * dim * LANES;
+        }
+
+        const float* block(size_t b) const {
+            return data.data() + b * dim * LANES;
+        }
+
+        float at(size_t i, dim_t d) const {
+            return block(i / LANES)[d * LANES + i % LANES];
+        }
+
+        void reserve(size_t n) { data.reserve(blocks_for(n) * dim * LANES); }
+
+        // Grows (or shrinks) to n vectors; new lanes start at zero.
+        void resize(size_t n){
+            data.resize(blocks_for(n) * dim * LANES , 0.0f);
+            size = n;
+        }
+
+        // Writes vector i; distinct i may be set concurrently.
+        void set(size_t i , const float* v){
+            float* blk = block(i / LANES);
+            size_t lane = i % LANES;
+            for(dim_t d = 0 ; d < dim ; ++d) blk[d * LANES + lane] = v[d];
+        }
+
+        void append(const float* v){
+            if(size % LANES == 0) data.resize(data.size() + dim * LANES , 0.0f);
+
+            set(size , v);
+            size++;
         }
     };
-}
\ No newline at end of file
+
+    // Contiguous row-major arena (AoS) with a 64-byte aligned base. Rows
+    // are dim floats apart with no per-vector header or allocation, so a
+    // scan is one linear stream the hardware prefetcher can follow, and
+    // the whole arena can be written out or mapped as one block.
+    class VectorStore{
+        public:
+            explicit VectorStore(dim_t dim = 0) : dim_(dim) {}
+
+            dim_t dim() const {return dim_;}
+            size_t size() const {return dim_ ? data_.size() / dim_ : 0;}
+            bool empty() const {return data_.empty();}
+            size_t capacity() const {return dim_ ? data_.capacity() / dim_ : 0;}
+
+            void reserve(size_t n) {data_.reserve(n * dim_);}
+            void clear() {data_.clear();}
+
+            // Read-only view of n rows at p (e.g. a mapped index section);
+            // the first mutation copies them into owned storage.
+            void borrow(const float* p , size_t n , shared_ptr<const void> keep){
+                data_ = MappedVector<float>::borrow(p , n * dim_ , move(keep));
+            }
+
+            bool borrowed() const {return data_.borrowed();}
+
+            // Grows (or shrinks) to n rows in one step; bulk loaders resize
+            // once and then fill the new rows, possibly from many threads.
+            void resize(size_t n) {data_.resize(n * dim_);}
+
+            // Growth is geometric, so n appends cost O(n) amortized.
+            size_t append(const float* v){
+                data_.insert(data_.end() , v , v + dim_);
+                return size() - 1;
+            }
+
+            float* row(size_t i) {return data_.data() + i * dim_;}
+            const float* row(size_t i) const {return data_.data() + i * dim_;}
+
+            VectorView view(size_t i) const {return VectorView(row(i) , dim_);}
+
+            float* data() {return data_.data();}
+            const float* data() const {return data_.data();}
+
+        private:
+            dim_t dim_;
+            MappedVector<float> data_;
+    };
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <cstdint>
+
+#include "../core/id_selector.h"
+#include "linear_scan.h"
+#include "ivf.h"
+
+using namespace std;
+
+namespace vdb {
+
+    struct DynamicConfig{
+        double compact_ratio = 0.2;   // dead / stored rows that triggers a compaction
+        bool background = true;       // run triggered compactions on a worker thread
+    };
+
+    // Search adapters: the tombstones go in as the scan's selector.
+    inline vector<pair<idx_t , dist_t>> search_live(const LinearScanIndex& index , const Vector& query , size_t k ,
+                                                    const IDSelector* sel , size_t refine_factor = 0){
+        return index.search(query , k , sel , refine_factor);
+    }
+
+    inline vector<pair<idx_t , dist_t>> search_live(const IVFIndex& index , const Vector& query , size_t k ,
+                                                    const IDSelector* sel , size_t nprobe){
+        return index.search(query , k , nprobe , sel);
+    }
+
+    // Whether a compaction would strand a row-numbered side store.
+    inline bool has_refine_store(const LinearScanIndex& index) {return index.refine_store() != nullptr;}
+    inline bool has_refine_store(const IVFIndex&) {return false;}
+
+    // Mutable front end for an append-only index (LinearScanIndex,
+    // IVFIndex) keyed by external 64-bit labels.
+    //
+    // Rows are never edited in place: remove() marks the row dead in a
+    // tombstone bitset that every scan checks before scoring, and upsert()
+    // kills the old row of its label and appends a new one. Once dead
+    // rows pass compact_ratio of the stored ones, a compaction rewrites
+    // the index from the live rows (Index::compacted) and renumbers them,
+    // so scans stop paying for the dead ones.
+    //
+    // A LinearScanIndex refine store is numbered by row id, which a
+    // compaction reassigns, so no compaction is triggered while one is
+    // attached and compact() throws. To compact anyway, detach it with
+    // set_refine_store(nullptr), compact, rebuild the store in
+    // row_labels() order and attach it again.
+    //
+    // Locking: searches share rw_. Writers serialize on write_ and hold
+    // rw_ exclusively only while they mutate. A compaction holds write_
+    // for the whole rebuild, so upserts and removes block until it is
+    // done; readers keep searching the old index and wait only for the
+    // swap, the one step that takes rw_.
+    template<typename Index>
+    class DynamicIndex{
+        public:
+            using label_t = uint64_t;
+
+            // index must be empty, and trained when its kind needs it.
+            explicit DynamicIndex(Index index , DynamicConfig dcfg = {}) : index_(move(index)) , dcfg_(dcfg) {
+                if(index_.size() != 0) throw runtime_error("DynamicIndex: the index must start empty");
+            }
+
+            ~DynamicIndex() {wait_compaction();}
+
+            DynamicIndex(const DynamicIndex&) = delete;
+            DynamicIndex& operator=(const DynamicIndex&) = delete;
+
+            void upsert(label_t label , const float* x) {upsert_batch(&label , x , 1);}
+
+            // n row-major vectors; a label already present (or repeated
+            // within the batch) keeps only its last vector.
+            void upsert_batch(const label_t* labels , const float* data , size_t n){
+                if(n == 0) return;
+
+                lock_guard<mutex> w(write_);
+                {
+                    unique_lock<shared_mutex> rw(rw_);
+                    const size_t base = labels_.size();
+                    if(base + n > NO_ID) throw runtime_error("DynamicIndex: row ids exhausted");
+
+                    index_.add_batch(data , n);
+                    dead_.resize(base + n);
+                    labels_.insert(labels_.end() , labels , labels + n);
+
+                    for(size_t i = 0 ; i<n ; ++i){
+                        auto it = ids_.try_emplace(labels[i] , static_cast<idx_t>(base + i));
+                        if(it.second) continue;
+                        dead_.kill(it.first->second);
+                        it.first->second = static_cast<idx_t>(base + i);
+                    }
+                }
+                maybe_compact();
+            }
+
+            // false when the label is not present
+            bool remove(label_t label){
+                lock_guard<mutex> w(write_);
+                {
+                    unique_lock<shared_mutex> rw(rw_);
+                    auto it = ids_.find(label);
+                    if(it == ids_.end()) return false;
+                    dead_.kill(it->second);
+                    ids_.erase(it);
+                }
+                maybe_compact();
+                return true;
+            }
+
+            // The k nearest live vectors as (label , distance), closest first.
+            // extra are the index's own arguments after the selector (nprobe
+            // for IVFIndex, refine_factor for LinearScanIndex).
+            template<typename... Args>
+            vector<pair<label_t , dist_t>> search(const Vector& query , size_t k , Args... extra) const {
+                shared_lock<shared_mutex> rw(rw_);
+
+                const IDSelector* sel = dead_.dead() ? &dead_ : nullptr;
+                const vector<pair<idx_t , dist_t>> hits = search_live(index_ , query , k , sel , extra...);
+
+                vector<pair<label_t , dist_t>> out;
+                out.reserve(hits.size());
+                for(auto& h : hits) out.emplace_back(labels_[h.first] , h.second);
+                return out;
+            }
+
+            bool contains(label_t label) const {
+                shared_lock<shared_mutex> rw(rw_);
+                return ids_.count(label) != 0;
+            }
+
+            // Live vectors.
+            size_t size() const {
+                shared_lock<shared_mutex> rw(rw_);
+                return ids_.size();
+            }
+
+            // Dead rows / stored rows.
+            double tombstone_ratio() const {
+                shared_lock<shared_mutex> rw(rw_);
+                return labels_.empty() ? 0.0 : static_cast<double>(dead_.dead()) / labels_.size();
+            }
+
+            // Row id -> label, dead rows included: the order a refine store
+            // attached after the last compaction must follow.
+            vector<label_t> row_labels() const {
+                shared_lock<shared_mutex> rw(rw_);
+                return labels_;
+            }
+
+            // LinearScanIndex only; see the class comment.
+            void set_refine_store(const VectorStore* raw){
+                lock_guard<mutex> w(write_);
+                unique_lock<shared_mutex> rw(rw_);
+                index_.set_refine_store(raw);
+            }
+
+            // Rewrites the index without its dead rows now, on this thread.
+            // Throws, leaving the index as it was, while a refine store is
+            // attached.
+            void compact(){
+                lock_guard<mutex> w(write_);
+                compact_locked();
+            }
+
+            // Blocks until a background compaction, if any, has finished.
+            void wait_compaction(){
+                thread t;
+                {
+                    lock_guard<mutex> w(write_);
+                    t = move(worker_);
+                }
+                if(t.joinable()) t.join();
+            }
+
+        private:
+            // All of these run under write_.
+
+            bool over_threshold() const {
+                return dead_.dead() > 0 && dead_.dead() >= dcfg_.compact_ratio * labels_.size();
+            }
+
+            void maybe_compact(){
+                if(compacting_ || !over_threshold() || has_refine_store(index_)) return;
+
+                if(!dcfg_.background){
+                    compact_locked();
+                    return;
+                }
+
+                // the previous worker already left write_, joining is short
+                compacting_ = true;
+                if(worker_.joinable()) worker_.join();
+                worker_ = thread([this] {
+                    {
+                        lock_guard<mutex> w(write_);
+                        if(over_threshold() && !has_refine_store(index_)) compact_locked();
+                    }
+                    compacting_ = false;
+                });
+            }
+
+            // Live rows keep their relative order and take ids 0 .. live - 1.
+            // Only readers run concurrently, so the old index is read
+            // without rw_; the swap takes it exclusively.
+            void compact_locked(){
+                if(dead_.dead() == 0) return;
+
+                const size_t n = labels_.size();
+                vector<idx_t> remap(n , NO_ID);
+                vector<label_t> labels;
+                labels.reserve(n - dead_.dead());
+                for(size_t i = 0 ; i<n ; ++i){
+                    if(dead_.is_dead(static_cast<idx_t>(i))) continue;
+                    remap[i] = static_cast<idx_t>(labels.size());
+                    labels.push_back(labels_[i]);
+                }
+
+                Index index = index_.compacted(remap);
+
+                unordered_map<label_t , idx_t> ids;
+                ids.reserve(labels.size());
+                for(size_t i = 0 ; i<labels.size() ; ++i) ids.emplace(labels[i] , static_cast<idx_t>(i));
+
+                Tombstones dead;
+                dead.resize(labels.size());
+
+                {
+                    unique_lock<shared_mutex> rw(rw_);
+                    swap(index_ , index);
+                    swap(labels_ , labels);
+                    swap(ids_ , ids);
+                    swap(dead_ , dead);
+                }
+                // the old generation is freed here, outside the lock
+            }
+
+            Index index_;
+            DynamicConfig dcfg_;
+            vector<label_t> labels_;                  // row id -> label, dead rows included
+            unordered_map<label_t , idx_t> ids_;      // live label -> row id
+            Tombstones dead_;
+
+            mutable shared_mutex rw_;
+            mutex write_;
+            thread worker_;
+            atomic<bool> compacting_{false};
+    };
+}
@@ -0,0 +1,121 @@
+#include "hnsw_graph.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "../../core/parallel.h"
+
+using namespace std;
+
+namespace vdb{
+
+    namespace {
+        size_t round_up(size_t x , size_t a) {return (x + a - 1) / a * a;}
+    }
+
+    HNSWIndex::HNSWIndex(dim_t dim , HNSWConfig hcfg , SearchConfig cfg):
+        dim_(dim) , hcfg_(hcfg) , cfg_(cfg) , kern_(kernels_for(cfg.distance)) ,
+        level_rng_(hcfg.seed) , link_locks_(new mutex[LOCK_STRIPES]) {
+            assert(hcfg_.M >= 2);
+
+            M0_ = 2 * hcfg_.M;
+            links_bytes_ = round_up((M0_ + 1) * sizeof(idx_t) , 64);
+            stride_ = round_up(links_bytes_ + dim_ * sizeof(float) , 64);
+            level_mult_ = 1.0 / log(static_cast<double>(hcfg_.M));
+        }
+
+    void HNSWIndex::reserve(size_t n){
+        level0_.reserve(n * stride_);
+        upper_offset_.reserve(n);
+        levels_.reserve(n);
+    }
+
+    int HNSWIndex::random_level(){
+        // P(level >= l) = M^-l
+        uniform_real_distribution<double> u(0.0 , 1.0);
+        double r = 1.0 - u(level_rng_);   // (0 , 1]
+        return min(static_cast<int>(-log(r) * level_mult_) , 255);
+    }
+
+    vector<float> HNSWIndex::prepare(const float* x) const {
+        vector<float> v(x , x + dim_);
+        if(cfg_.metric == Metric::COSINE){
+            float n = norm(v.data() , dim_ , kern_);
+            if(n > 0.0f) for(float& f : v) f /= n;
+        }
+        return v;
+    }
+
+    void HNSWIndex::add(const Vector& v){
+        assert(v.dim == dim_);
+        add_batch(v.raw() , 1);
+    }
+
+    void HNSWIndex::add_batch(const float* data , size_t n){
+        if(n == 0) return;
+
+        const size_t first = ntotal_;
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD;
+
+        // Every record, level and upper link block is allocated before any
+        // insert starts, so concurrent inserts never see a reallocation.
+        level0_.resize((first + n) * stride_ , 0);
+        levels_.resize(first + n);
+        upper_offset_.resize(first + n);
+        for(size_t r = 0 ; r<n ; ++r){
+            const int level = random_level();
+            levels_[first + r] = static_cast<uint8_t>(level);
+            upper_offset_[first + r] = upper_links_.size();
+            upper_links_.resize(upper_links_.size() + level*(hcfg_.M + 1) , 0);
+        }
+
+        #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(par && n >= 4096)
+        for(size_t r = 0 ; r<n ; ++r){
+            vector<float> v = prepare(data + r*dim_);
+            memcpy(level0_.data() + (first + r)*stride_ + links_bytes_ , v.data() , dim_ * sizeof(float));
+        }
+
+        ntotal_ = first + n;
+
+        size_t r0 = 0;
+        if(max_level_ < 0){
+            entry_ = static_cast<idx_t>(first);
+            max_level_ = levels_[first];
+            r0 = 1;
+        }
+
+        #pragma omp parallel for schedule(dynamic , 16) num_threads(num_threads(cfg_)) if(par)
+        for(size_t r = r0 ; r<n ; ++r) insert(static_cast<idx_t>(first + r) , par);
+    }
+
+    void HNSWIndex::insert(idx_t id , bool lock){
+        const int level = levels_[id];
+        const float* q = vec(id);
+
+        // only a node that becomes the new entry point keeps the global lock
+        unique_lock<mutex> global(global_lock_);
+        const int top = max_level_;
+        const idx_t ep = entry_;
+        if(level <= top) global.unlock();
+
+        Candidate cur = greedy_descent(q , Candidate(distance(q , vec(ep)) , ep) , top , level , lock);
+
+        unique_ptr<VisitedList> visited = visited_pool_.acquire(ntotal_);
+        for(int l = min(level , top) ; l>=0 ; --l){
+            visited->reset(ntotal_);
+            priority_queue<Candidate> found = search_layer(q , cur , hcfg_.ef_construction , l , *visited , lock);
+
+            vector<Candidate> cands(found.size());
+            for(size_t i = cands.size() ; i-- > 0 ; found.pop()) cands[i] = found.top();
+
+            cur = cands.front();
+            connect(id , l , cands , lock);
+        }
+        visited_pool_.release(move(visited));
+
+        if(level > top){
+            entry_ = id;
+            max_level_ = level;
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <random>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "../../core/vector.h"
+#include "../../core/distance.h"
+#include "../../core/vector_block.h"
+#include "../../core/topk.h"
+#include "../../core/id_selector.h"
+#include "../../core/range_search.h"
+#include "neighbor_selection.h"
+#include "search.h"
+
+using namespace std;
+
+namespace vdb {
+
+    struct HNSWConfig{
+        size_t M = 16;                  // links per node on the upper layers, 2*M on layer 0
+        size_t ef_construction = 200;   // beam width while inserting
+        size_t ef_search = 64;          // default beam width for search()
+        bool prefetch = true;           // batched neighbour expansion with software prefetch
+        uint32_t seed = 100;            // level assignment
+    };
+
+    // Hierarchical navigable small world graph (Malkov & Yashunin).
+    //
+    // Storage is flat: every node owns one fixed-stride, cache-line aligned
+    // record in level0_ holding its layer-0 links ([count , ids...]) followed
+    // by its vector, so a hop reads the neighbour ids and the distance
+    // computation touches the same record. Upper-layer links (few nodes)
+    // live in one shared array indexed by upper_offset_. No per-node heap
+    // objects anywhere. Ids are insertion order.
+    //
+    // COSINE vectors (and queries) are normalized on the way in, so all
+    // three metrics cost one kernel call per distance.
+    //
+    // add_batch inserts in parallel under a non-SINGLE_THREAD exec policy:
+    // link lists are guarded by striped locks (one short critical section
+    // per read or update, never two held at once) and the global lock is
+    // kept for a whole insert only by a node that raises the max level.
+    class HNSWIndex{
+        public:
+            static constexpr size_t LOCK_STRIPES = 1 << 14;
+
+            HNSWIndex(dim_t dim , HNSWConfig hcfg = {} , SearchConfig cfg = {});
+
+            void reserve(size_t n);
+
+            void add(const Vector& v);
+
+            // Records for all n vectors are allocated up front, then the
+            // inserts run on num_threads(cfg) threads (dynamic schedule).
+            void add_batch(const float* data , size_t n);
+
+            // Greedy descent through the upper layers, then an ef-bounded
+            // beam search on layer 0 (ef = 0 uses hcfg.ef_search).
+            //
+            // With a selector the beam still walks through every node but
+            // only members enter the results, and ef is widened by
+            // 1 / selectivity. When the allowed set is no larger than what
+            // that widened search would score (about ef * M distances), the
+            // members are scored directly instead.
+            vector<pair<idx_t , dist_t>> search(const Vector& query , size_t k , size_t ef = 0 ,
+                                                const IDSelector* sel = nullptr) const;
+
+            // Vectors with distance < radius, closest first. A beam search
+            // returns at most ef hits, so ef (0 = hcfg.ef_search) is doubled
+            // until some result falls outside the radius; approximate like
+            // search().
+            vector<pair<idx_t , dist_t>> range_search(const Vector& query , dist_t radius , size_t ef = 0) const;
+
+            // Batch form, packed as CSR (see RangeSearchResult).
+            RangeSearchResult range_search(const vector<Vector>& queries , dist_t radius , size_t ef = 0) const;
+
+            size_t size() const {return ntotal_;}
+            dim_t dim() const {return dim_;}
+            int max_level() const {return max_level_;}
+            int level(idx_t i) const {return levels_[i];}
+            const HNSWConfig& config() const {return hcfg_;}
+
+            // Toggles HNSWConfig::prefetch for later searches (and inserts).
+            void set_prefetch(bool on) {hcfg_.prefetch = on;}
+
+            // stored vector (normalized under COSINE)
+            const float* vec(idx_t i) const {
+                return reinterpret_cast<const float*>(level0_.data() + i*stride_ + links_bytes_);
+            }
+
+            // [count , ids...] of node i on a layer it belongs to
+            const idx_t* links(idx_t i , int level) const {
+                return level == 0 ? reinterpret_cast<const idx_t*>(level0_.data() + i*stride_)
+                                  : upper_links_.data() + upper_offset_[i] + (level - 1)*(hcfg_.M + 1);
+            }
+
+        private:
+            dim_t dim_;
+            HNSWConfig hcfg_;
+            SearchConfig cfg_;
+            const DistanceKernels& kern_;
+
+            size_t M0_;            // layer-0 capacity
+            size_t links_bytes_;   // layer-0 link block, padded to 64 bytes
+            size_t stride_;        // bytes per layer-0 record, multiple of 64
+
+            size_t ntotal_ = 0;
+            idx_t entry_ = 0;
+            int max_level_ = -1;
+
+            aligned_vector<uint8_t> level0_;
+            vector<idx_t> upper_links_;
+            vector<size_t> upper_offset_;
+            vector<uint8_t> levels_;
+
+            mt19937 level_rng_;
+            double level_mult_;
+
+            mutable VisitedListPool visited_pool_;
+
+            unique_ptr<mutex[]> link_locks_;
+            mutex global_lock_;   // entry_ and max_level_
+
+            mutex& link_lock(idx_t i) const {return link_locks_[i & (LOCK_STRIPES - 1)];}
+
+            // Neighbours of node i on a layer. With lock set (parallel build)
+            // they are copied into buf under the node's stripe lock, otherwise
+            // the stored list is returned as is.
+            const idx_t* neighbors(idx_t i , int level , bool lock , vector<idx_t>& buf , size_t& count) const;
+
+            idx_t* links(idx_t i , int level){
+                return const_cast<idx_t*>(static_cast<const HNSWIndex*>(this)->links(i , level));
+            }
+
+            dist_t distance(const float* a , const float* b) const {
+                switch(cfg_.metric){
+                    case Metric::L2:            return kern_.l2(a , b , dim_);
+                    case Metric::INNER_PRODUCT: return -kern_.inner_product(a , b , dim_);
+                    default:                    return 1.0f - kern_.inner_product(a , b , dim_);
+                }
+            }
+
+            // out[i] = distance(query , rows[i]) with one gathered kernel call.
+            void distances(const float* query , const float* const* rows , size_t n , dist_t* out) const {
+                if(cfg_.metric == Metric::L2){
+                    kern_.l2_gather(query , rows , n , dim_ , out);
+                    return;
+                }
+                kern_.inner_product_gather(query , rows , n , dim_ , out);
+                const float bias = cfg_.metric == Metric::COSINE ? 1.0f : 0.0f;
+                for(size_t i = 0 ; i<n ; ++i) out[i] = bias - out[i];
+            }
+
+            // Pulls the vector of node i towards L1 ahead of a gathered distance call.
+            void prefetch_vector(idx_t i) const {
+                const char* p = reinterpret_cast<const char*>(vec(i));
+                const size_t bytes = min<size_t>(dim_ * sizeof(float) , 1024);
+                for(size_t off = 0 ; off<bytes ; off += 64) __builtin_prefetch(p + off);
+            }
+
+            int random_level();
+
+            // query copy, normalized under COSINE
+            vector<float> prepare(const float* x) const;
+
+            // Links an already stored node into the graph.
+            void insert(idx_t id , bool lock);
+
+            /* search.cpp */
+
+            // From cur on layer from down to layer target + 1, always moving
+            // to the closest neighbour; returns the final node and its distance.
+            Candidate greedy_descent(const float* query , Candidate cur , int from , int target , bool lock) const;
+
+            // ef-bounded beam search on one layer, as a max-heap of at most ef.
+            // With hcfg.prefetch, the unvisited neighbours of a node are first
+            // collected (their visited marks and vectors prefetched) and then
+            // scored in one one-to-many kernel call, and the next candidate's
+            // link block is prefetched while the current one is expanded.
+            // Under a selector, non-members are expanded but never returned.
+            priority_queue<Candidate> search_layer(const float* query , Candidate entry , size_t ef ,
+                                                   int level , VisitedList& visited , bool lock ,
+                                                   const IDSelector* sel = nullptr) const;
+
+            // Exact top-k over the members of sel (enumerated when possible).
+            vector<pair<idx_t , dist_t>> search_allowed(const float* query , size_t k , const IDSelector& sel) const;
+
+            /* neighbor_selection.cpp */
+
+            // Links a new node on one layer to the heuristic pick of its
+            // candidates (ascending) and adds the back-links, re-pruning any
+            // neighbour that overflows.
+            void connect(idx_t node , int level , vector<Candidate>& candidates , bool lock);
+
+            // Shrinks candidates (ascending) to at most m with the diversity heuristic.
+            void prune(vector<Candidate>& candidates , size_t m) const;
+    };
+}
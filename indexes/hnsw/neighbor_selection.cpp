@@ -0,0 +1,54 @@
+#include "hnsw_graph.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace vdb{
+
+    void HNSWIndex::prune(vector<Candidate>& candidates , size_t m) const {
+        select_neighbors_heuristic(candidates , m , [&] (idx_t a , idx_t b) {
+            return distance(vec(a) , vec(b));
+        });
+    }
+
+    void HNSWIndex::connect(idx_t node , int level , vector<Candidate>& candidates , bool lock){
+        const size_t cap = level == 0 ? M0_ : hcfg_.M;
+
+        // the new node keeps M links per layer, leaving layer-0 room for back-links
+        prune(candidates , hcfg_.M);
+
+        {
+            unique_lock<mutex> guard(link_lock(node) , defer_lock);
+            if(lock) guard.lock();
+
+            idx_t* own = links(node , level);
+            own[0] = static_cast<idx_t>(candidates.size());
+            for(size_t i = 0 ; i<candidates.size() ; ++i) own[i + 1] = candidates[i].second;
+        }
+
+        for(const Candidate& c : candidates){
+            unique_lock<mutex> guard(link_lock(c.second) , defer_lock);
+            if(lock) guard.lock();
+
+            idx_t* nl = links(c.second , level);
+            const size_t cnt = nl[0];
+
+            if(cnt < cap){
+                nl[cnt + 1] = node;
+                nl[0] = static_cast<idx_t>(cnt + 1);
+                continue;
+            }
+
+            // full: re-select among the old links plus the new node
+            vector<Candidate> pool;
+            pool.reserve(cnt + 1);
+            pool.emplace_back(c.first , node);
+            for(size_t i = 1 ; i<=cnt ; ++i) pool.emplace_back(distance(vec(c.second) , vec(nl[i])) , nl[i]);
+            sort(pool.begin() , pool.end());
+
+            prune(pool , cap);
+            nl[0] = static_cast<idx_t>(pool.size());
+            for(size_t i = 0 ; i<pool.size() ; ++i) nl[i + 1] = pool[i].second;
+        }
+    }
+}
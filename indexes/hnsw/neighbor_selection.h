@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+#include "../../core/types.h"
+
+using namespace std;
+
+namespace vdb {
+
+    // (distance , node id); ordered by distance, so a priority_queue of
+    // Candidates is a max-heap with the farthest on top.
+    using Candidate = pair<dist_t , idx_t>;
+
+    // Diversity heuristic (HNSW paper, Algorithm 4): walking the candidates
+    // closest first, keep one only if it is closer to the base node than to
+    // every candidate kept so far, until m are kept. This drops neighbours
+    // that sit in the same direction and keeps links to other clusters.
+    // candidates must be sorted ascending; dist(a , b) compares two nodes.
+    template<typename DistFn>
+    void select_neighbors_heuristic(vector<Candidate>& candidates , size_t m , DistFn&& dist){
+        if(candidates.size() <= m) return;
+
+        vector<Candidate> kept;
+        kept.reserve(m);
+
+        for(const Candidate& c : candidates){
+            if(kept.size() >= m) break;
+
+            bool good = true;
+            for(const Candidate& s : kept){
+                if(dist(c.second , s.second) < c.first){
+                    good = false;
+                    break;
+                }
+            }
+            if(good) kept.push_back(c);
+        }
+
+        candidates.swap(kept);
+    }
+}
@@ -0,0 +1,184 @@
+#include "hnsw_graph.h"
+#include <cassert>
+#include <limits>
+
+using namespace std;
+
+namespace vdb{
+
+    const idx_t* HNSWIndex::neighbors(idx_t i , int level , bool lock , vector<idx_t>& buf , size_t& count) const {
+        const idx_t* nl = links(i , level);
+        if(!lock){
+            count = nl[0];
+            return nl + 1;
+        }
+
+        lock_guard<mutex> guard(link_lock(i));
+        count = nl[0];
+        buf.assign(nl + 1 , nl + 1 + count);
+        return buf.data();
+    }
+
+    Candidate HNSWIndex::greedy_descent(const float* query , Candidate cur , int from , int target , bool lock) const {
+        vector<idx_t> buf;
+
+        for(int l = from ; l>target ; --l){
+            bool changed = true;
+            while(changed){
+                changed = false;
+
+                size_t cnt;
+                const idx_t* nl = neighbors(cur.second , l , lock , buf , cnt);
+                for(size_t i = 0 ; i<cnt ; ++i){
+                    dist_t d = distance(query , vec(nl[i]));
+                    if(d < cur.first){
+                        cur = Candidate(d , nl[i]);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        return cur;
+    }
+
+    priority_queue<Candidate> HNSWIndex::search_layer(const float* query , Candidate entry , size_t ef ,
+                                                      int level , VisitedList& visited , bool lock ,
+                                                      const IDSelector* sel) const {
+        // candidates: min-heap of the frontier; top: max-heap of the best ef so far
+        priority_queue<Candidate , vector<Candidate> , greater<Candidate>> candidates;
+        priority_queue<Candidate> top;
+
+        vector<idx_t> buf;
+
+        visited.visit(entry.second);
+        candidates.push(entry);
+        if(!sel || sel->is_member(entry.second)) top.push(entry);
+
+        auto consider = [&] (idx_t n , dist_t d) {
+            if(top.size() < ef || d < top.top().first){
+                candidates.emplace(d , n);
+                if(sel && !sel->is_member(n)) return;
+                top.emplace(d , n);
+                if(top.size() > ef) top.pop();
+            }
+        };
+
+        if(!hcfg_.prefetch){
+            while(!candidates.empty()){
+                Candidate c = candidates.top();
+                if(top.size() >= ef && c.first > top.top().first) break;
+                candidates.pop();
+
+                size_t cnt;
+                const idx_t* nl = neighbors(c.second , level , lock , buf , cnt);
+                for(size_t i = 0 ; i<cnt ; ++i){
+                    idx_t n = nl[i];
+                    if(!visited.test_and_visit(n)) consider(n , distance(query , vec(n)));
+                }
+            }
+            return top;
+        }
+
+        const size_t cap = level == 0 ? M0_ : hcfg_.M;
+        vector<idx_t> ids(cap);
+        vector<const float*> rows(cap);
+        vector<dist_t> dists(cap);
+
+        while(!candidates.empty()){
+            Candidate c = candidates.top();
+            if(top.size() >= ef && c.first > top.top().first) break;
+            candidates.pop();
+
+            if(!candidates.empty()) __builtin_prefetch(links(candidates.top().second , level));
+
+            size_t cnt;
+            const idx_t* nl = neighbors(c.second , level , lock , buf , cnt);
+            for(size_t i = 0 ; i<cnt ; ++i) visited.prefetch(nl[i]);
+
+            size_t m = 0;
+            for(size_t i = 0 ; i<cnt ; ++i){
+                idx_t n = nl[i];
+                if(visited.test_and_visit(n)) continue;
+                prefetch_vector(n);
+                ids[m] = n;
+                rows[m++] = vec(n);
+            }
+            if(m == 0) continue;
+
+            distances(query , rows.data() , m , dists.data());
+            for(size_t j = 0 ; j<m ; ++j) consider(ids[j] , dists[j]);
+        }
+
+        return top;
+    }
+
+    vector<pair<idx_t , dist_t>> HNSWIndex::search_allowed(const float* query , size_t k , const IDSelector& sel) const {
+        constexpr size_t BATCH = 64;
+
+        vector<idx_t> ids;
+        if(!sel.members(ntotal_ , ids)){
+            for(size_t i = 0 ; i<ntotal_ ; ++i) if(sel.is_member(static_cast<idx_t>(i))) ids.push_back(static_cast<idx_t>(i));
+        }
+
+        TopKCollector top(k);
+        const float* rows[BATCH];
+        dist_t dists[BATCH];
+        for(size_t b = 0 ; b<ids.size() ; b += BATCH){
+            const size_t n = min(BATCH , ids.size() - b);
+            for(size_t j = 0 ; j<n ; ++j) rows[j] = vec(ids[b + j]);
+            distances(query , rows , n , dists);
+            top.push_ids(dists , ids.data() + b , n);
+        }
+        return top.sorted_results();
+    }
+
+    vector<pair<idx_t , dist_t>> HNSWIndex::search(const Vector& query , size_t k , size_t ef ,
+                                                   const IDSelector* sel) const {
+        assert(query.dim == dim_);
+        if(ntotal_ == 0 || k == 0) return {};
+
+        ef = max(ef ? ef : hcfg_.ef_search , k);
+
+        vector<float> q = prepare(query.raw());
+
+        if(sel){
+            const double f = selectivity(*sel , ntotal_);
+            ef = filtered_width(ef , ntotal_ , f);
+            if(f * ntotal_ <= static_cast<double>(ef * hcfg_.M)) return search_allowed(q.data() , k , *sel);
+        }
+
+        Candidate entry = greedy_descent(q.data() , Candidate(distance(q.data() , vec(entry_)) , entry_) , max_level_ , 0 , false);
+
+        unique_ptr<VisitedList> visited = visited_pool_.acquire(ntotal_);
+        priority_queue<Candidate> top = search_layer(q.data() , entry , ef , 0 , *visited , false , sel);
+        visited_pool_.release(move(visited));
+
+        while(top.size() > k) top.pop();
+
+        vector<pair<idx_t , dist_t>> out(top.size());
+        for(size_t i = out.size() ; i-- > 0 ; top.pop()) out[i] = {top.top().second , top.top().first};
+        return out;
+    }
+
+    vector<pair<idx_t , dist_t>> HNSWIndex::range_search(const Vector& query , dist_t radius , size_t ef) const {
+        ef = ef ? ef : hcfg_.ef_search;
+
+        for(;;){
+            vector<pair<idx_t , dist_t>> res = search(query , ef , ef);
+
+            size_t m = 0;
+            while(m < res.size() && res[m].second < radius) ++m;
+
+            if(m < res.size() || ef >= ntotal_){
+                res.resize(m);
+                return res;
+            }
+            ef = min(ntotal_ , 2*ef);
+        }
+    }
+
+    RangeSearchResult HNSWIndex::range_search(const vector<Vector>& queries , dist_t radius , size_t ef) const {
+        return range_search_batch(queries.size() , cfg_ , [&] (size_t q) {return range_search(queries[q] , radius , ef);});
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+
+#include "../../core/types.h"
+
+using namespace std;
+
+namespace vdb {
+
+    // Visited set for one graph traversal. Instead of clearing n flags per
+    // query, a node is visited iff marks_[i] == epoch_, and reset() just
+    // bumps the epoch (the array is cleared only when the epoch wraps).
+    class VisitedList{
+        public:
+            explicit VisitedList(size_t n) : marks_(n , 0) {}
+
+            // Starts a new traversal over at least n nodes.
+            void reset(size_t n){
+                if(marks_.size() < n) marks_.resize(n , 0);
+                if(++epoch_ == 0){
+                    fill(marks_.begin() , marks_.end() , 0);
+                    epoch_ = 1;
+                }
+            }
+
+            bool visited(idx_t i) const {return marks_[i] == epoch_;}
+            void prefetch(idx_t i) const {__builtin_prefetch(marks_.data() + i);}
+            void visit(idx_t i) {marks_[i] = epoch_;}
+
+            // visit(i), returning whether it was already visited
+            bool test_and_visit(idx_t i){
+                if(marks_[i] == epoch_) return true;
+                marks_[i] = epoch_;
+                return false;
+            }
+
+        private:
+            vector<uint16_t> marks_;
+            uint16_t epoch_ = 0;
+    };
+
+    // Free VisitedLists shared by concurrent searches; a list is taken for
+    // one traversal and handed back afterwards, so steady-state queries
+    // never allocate.
+    class VisitedListPool{
+        public:
+            unique_ptr<VisitedList> acquire(size_t n){
+                unique_ptr<VisitedList> v;
+                {
+                    lock_guard<mutex> lock(mutex_);
+                    if(!free_.empty()){
+                        v = move(free_.back());
+                        free_.pop_back();
+                    }
+                }
+                if(!v) v = make_unique<VisitedList>(n);
+                v->reset(n);
+                return v;
+            }
+
+            void release(unique_ptr<VisitedList> v){
+                lock_guard<mutex> lock(mutex_);
+                free_.push_back(move(v));
+            }
+
+        private:
+            mutex mutex_;
+            vector<unique_ptr<VisitedList>> free_;
+    };
+}
@@ -0,0 +1,138 @@
+#include "inverted_list.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace vdb {
+
+    void InvertedList::reserve(size_t n){
+        constexpr size_t L = VectorBlock::LANES;
+        const size_t free = chunks_.empty() ? 0 : chunks_.back().capacity - chunks_.back().size;
+        if(n > free) reserved_ = max(reserved_ , (n - free + L - 1) / L * L);
+    }
+
+    void InvertedList::append(const float* v , idx_t id , float norm){
+        if(chunks_.empty() || chunks_.back().size == chunks_.back().capacity){
+            size_t cap = chunks_.empty() ? MIN_CHUNK : min(MAX_CHUNK , chunks_.back().capacity * 2);
+            cap = max(cap , reserved_);
+            reserved_ = 0;
+
+            Chunk c;
+            c.capacity = cap;
+            c.data.assign(cap * dim_ , 0.0f);   // zeroed, so padded SOA lanes stay finite
+            c.ids.reserve(cap);
+            c.norms.reserve(cap);
+            chunks_.push_back(move(c));
+        }
+
+        Chunk& c = chunks_.back();
+        size_t i = c.size;
+
+        if(layout_ == LayoutType::SOA){
+            constexpr size_t L = VectorBlock::LANES;
+            float* blk = c.data.data() + (i / L) * dim_ * L + i % L;
+            for(dim_t d = 0 ; d<dim_ ; ++d) blk[d * L] = v[d];
+        }else{
+            copy(v , v + dim_ , c.data.data() + i * dim_);
+        }
+
+        c.ids.push_back(id);
+        c.norms.push_back(norm);
+        c.size++;
+        size_++;
+    }
+
+    InvertedList InvertedList::compacted(const vector<idx_t>& remap) const {
+        constexpr size_t L = VectorBlock::LANES;
+
+        InvertedList out(dim_ , layout_);
+        vector<float> x(dim_);
+        for(const Chunk& c : chunks_){
+            for(size_t i = 0 ; i<c.size ; ++i){
+                const idx_t id = remap[c.ids[i]];
+                if(id == NO_ID) continue;
+
+                const float* v = c.data.data() + i * dim_;
+                if(layout_ == LayoutType::SOA){
+                    const float* blk = c.data.data() + (i / L) * dim_ * L + i % L;
+                    for(dim_t d = 0 ; d<dim_ ; ++d) x[d] = blk[d * L];
+                    v = x.data();
+                }
+                out.append(v , id , c.norms[i]);
+            }
+        }
+
+        return out;
+    }
+
+    void InvertedList::scan(const DistanceComputer& dc , TopKCollector& top , const IDSelector* sel) const {
+        constexpr size_t L = VectorBlock::LANES;
+        constexpr size_t PIECE = 256;   // a multiple of LANES
+
+        dist_t out[PIECE];
+        uint8_t keep[PIECE];
+        for(const Chunk& c : chunks_){
+            for(size_t base = 0 ; base<c.size ; base += PIECE){
+                size_t cnt = min(PIECE , c.size - base);
+
+                if(sel){
+                    size_t kept = 0;
+                    for(size_t j = 0 ; j<cnt ; ++j) kept += keep[j] = sel->is_member(c.ids[base + j]);
+                    if(kept == 0) continue;
+                }
+
+                if(layout_ == LayoutType::SOA){
+                    for(size_t j = 0 ; j<cnt ; j += L){
+                        size_t lanes = min(L , cnt - j);
+                        if(sel && none_of(keep + j , keep + j + lanes , [] (uint8_t b) {return b;})){
+                            fill(out + j , out + j + lanes , numeric_limits<dist_t>::infinity());
+                            continue;
+                        }
+
+                        float block_norms[L] = {};
+                        copy(c.norms.data() + base + j , c.norms.data() + base + j + lanes , block_norms);
+
+                        dist_t blk[L];
+                        dc.block_distances(c.data.data() + (base + j) * dim_ , block_norms , blk);
+                        copy(blk , blk + lanes , out + j);
+                    }
+                    if(sel) for(size_t j = 0 ; j<cnt ; ++j) if(!keep[j]) out[j] = numeric_limits<dist_t>::infinity();
+                }else if(sel){
+                    dc.selected_distances(c.data.data() + base * dim_ , cnt , dim_ , c.norms.data() + base , keep , out);
+                }else{
+                    dc.distances(c.data.data() + base * dim_ , cnt , dim_ , c.norms.data() + base , out);
+                }
+
+                top.push_ids(out , c.ids.data() + base , cnt);
+            }
+        }
+    }
+
+    void InvertedList::range_scan(const DistanceComputer& dc , dist_t radius , vector<pair<idx_t , dist_t>>& hits) const {
+        constexpr size_t L = VectorBlock::LANES;
+        constexpr size_t PIECE = 256;   // a multiple of LANES
+
+        uint32_t idx[PIECE];
+        dist_t out[PIECE];
+        for(const Chunk& c : chunks_){
+            if(layout_ == LayoutType::SOA){
+                for(size_t j = 0 ; j<c.size ; j += L){
+                    size_t lanes = min(L , c.size - j);
+                    float block_norms[L] = {};
+                    copy(c.norms.data() + j , c.norms.data() + j + lanes , block_norms);
+
+                    dc.block_distances(c.data.data() + j * dim_ , block_norms , out);
+                    for(size_t l = 0 ; l<lanes ; ++l) if(out[l] < radius) hits.emplace_back(c.ids[j + l] , out[l]);
+                }
+                continue;
+            }
+
+            for(size_t base = 0 ; base<c.size ; base += PIECE){
+                size_t cnt = min(PIECE , c.size - base);
+                size_t m = dc.within(c.data.data() + base * dim_ , cnt , dim_ , c.norms.data() + base , radius , idx , out);
+                for(size_t i = 0 ; i<m ; ++i) hits.emplace_back(c.ids[base + idx[i]] , out[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <memory>
+
+#include "../core/vector_block.h"
+#include "../core/distance.h"
+#include "../core/topk.h"
+#include "../core/id_selector.h"
+
+using namespace std;
+
+namespace vdb {
+
+    // One IVF posting list, stored as a chain of packed chunks. A chunk
+    // holds its vectors in one aligned float block (row-major for AOS,
+    // 8-wide interleaved for SOA) next to their ids and norms. Chunk
+    // capacity doubles from MIN_CHUNK up to MAX_CHUNK, and a full chunk
+    // is never reallocated, so growing a list never copies old vectors
+    // and scanning it is a few long streaming kernel calls. reserve()
+    // sizes the next chunk for a known batch, past MAX_CHUNK if needed.
+    class InvertedList{
+        friend class IndexSerializer;   // storage/serialization.h
+
+        public:
+            static constexpr size_t MIN_CHUNK = 32;
+            static constexpr size_t MAX_CHUNK = 1024;
+
+            struct Chunk{
+                size_t capacity;
+                size_t size = 0;
+                MappedVector<float> data;     // capacity x dim, layout per list
+                MappedVector<idx_t> ids;
+                MappedVector<float> norms;    // |x|, for COSINE
+            };
+
+            InvertedList(dim_t dim , LayoutType layout) : dim_(dim) , layout_(layout) {}
+
+            size_t size() const {return size_;}
+            dim_t dim() const {return dim_;}
+            LayoutType layout() const {return layout_;}
+            const vector<Chunk>& chunks() const {return chunks_;}
+
+            void append(const float* v , idx_t id , float norm);
+
+            // Room for n more appends in at most one new chunk: whatever the
+            // tail chunk cannot take goes into a successor sized for it.
+            void reserve(size_t n);
+
+            // The list without the entries whose remap[id] is NO_ID, the
+            // others renamed to remap[id], repacked into fresh chunks.
+            InvertedList compacted(const vector<idx_t>& remap) const;
+
+            // Scores every vector of the list and feeds the collector. With a
+            // selector, ids are checked first and rejected vectors are not scored.
+            void scan(const DistanceComputer& dc , TopKCollector& top , const IDSelector* sel = nullptr) const;
+
+            // Appends (id , distance) for every vector with distance < radius.
+            void range_scan(const DistanceComputer& dc , dist_t radius , vector<pair<idx_t , dist_t>>& hits) const;
+
+        private:
+            dim_t dim_;
+            LayoutType layout_;
+            size_t size_ = 0;
+            vector<Chunk> chunks_;
+            size_t reserved_ = 0;   // capacity floor for the next chunk, see reserve()
+    };
+}
@@ -1,36 +1,183 @@
 #include "ivf.h"
-#include <random>
 #include <limits>
 #include <cassert>
-#include <iostream>
+#include <algorithm>
+
+#include "../core/parallel.h"
 
 using namespace std;
 
 namespace vdb{
 
     IVFIndex::IVFIndex(dim_t dim , size_t nlist , SearchConfig cfg):
-        dim_(dim) , nlist_(nlist) , cfg_(cfg){
+        dim_(dim) , nlist_(nlist) , cfg_(cfg) , centroids_(dim){
             centroids_.reserve(nlist_);
-            lists_.reserve(nlist_);
+            lists_.assign(nlist_ , InvertedList(dim_ , cfg_.layout));
         }
     
     void IVFIndex::train(const vector<Vector>& data , size_t max_iters){
         assert(data.size() >=nlist_);
 
-        mt19937 rng(64);
-        uniform_int_distribution<size_t> uni(0 , data.size() - 1);
+        VectorStore flat(dim_);
+        flat.reserve(data.size());
+        for(const auto& v : data) flat.append(v.raw());
+
+        KMeansConfig kcfg;
+        kcfg.max_iters = max_iters;
+        train(flat.data() , flat.size() , kcfg);
+    }
+
+    void IVFIndex::train(const float* data , size_t n , const KMeansConfig& kcfg){
+        assert(n >= nlist_);
+
+        centroids_ = kmeans(data , n , dim_ , nlist_ , kcfg , cfg_);
+    }
+
+    IVFIndex IVFIndex::compacted(const vector<idx_t>& remap) const {
+        assert(remap.size() == ntotal_);
+
+        IVFIndex out(dim_ , nlist_ , cfg_);
+        out.centroids_ = centroids_;
+
+        // lists are independent, so they are rewritten in parallel
+        #pragma omp parallel for schedule(dynamic , 1) num_threads(num_threads(cfg_)) if(cfg_.exec != ExecPolicy::SINGLE_THREAD)
+        for(size_t l = 0 ; l<nlist_ ; ++l) out.lists_[l] = lists_[l].compacted(remap);
+
+        out.ntotal_ = ntotal_ - count(remap.begin() , remap.end() , NO_ID);
+        return out;
+    }
+
+    size_t IVFIndex::assign_centroid(VectorView v) const {
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+
+        size_t best = 0;
+        float best_d = numeric_limits<float>::infinity();
+        for(size_t c = 0 ; c<centroids_.size() ; ++c){
+            float d = kern.l2(v.raw() , centroids_.row(c) , dim_);
+            if(d < best_d){best_d = d ; best = c;}
+        }
+
+        return best;
+    }
+
+    void IVFIndex::add(const Vector& v){
+        assert(v.dim == dim_ && centroids_.size() == nlist_);
+
+        size_t l = assign_centroid(v);
+        lists_[l].append(v.raw() , static_cast<idx_t>(ntotal_++) , norm(v.raw() , dim_ , kernels_for(cfg_.distance)));
+    }
+
+    void IVFIndex::add_batch(const float* data , size_t n){
+        assert(centroids_.size() == nlist_);
+        if(n == 0) return;
+
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD;
+        const int nt = num_threads(cfg_);
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+
+        vector<idx_t> assign(n);
+        assign_nearest(data , n , dim_ , centroids_ , assign.data() , nullptr , cfg_);
+
+        // counting sort by list, so each list is filled by exactly one thread
+        vector<size_t> offsets(nlist_ + 1 , 0);
+        for(size_t i = 0 ; i<n ; ++i) offsets[assign[i] + 1]++;
+        for(size_t l = 0 ; l<nlist_ ; ++l) offsets[l + 1] += offsets[l];
+
+        vector<size_t> order(n);
+        {
+            vector<size_t> fill = offsets;
+            for(size_t i = 0 ; i<n ; ++i) order[fill[assign[i]]++] = i;
+        }
+
+        #pragma omp parallel for schedule(dynamic) num_threads(nt) if(par)
+        for(size_t l = 0 ; l<nlist_ ; ++l){
+            size_t cnt = offsets[l + 1] - offsets[l];
+            if(cnt == 0) continue;
+
+            lists_[l].reserve(cnt);
+            for(size_t j = 0 ; j<cnt ; ++j){
+                size_t i = order[offsets[l] + j];
+                const float* x = data + i*dim_;
+                lists_[l].append(x , static_cast<idx_t>(ntotal_ + i) , norm(x , dim_ , kern));
+            }
+        }
+
+        ntotal_ += n;
+    }
+
+    vector<idx_t> IVFIndex::probe_lists(const float* query , size_t nprobe) const {
+        vector<dist_t> d(nlist_);
+        DistanceComputer dc(query , dim_ , Metric::L2 , kernels_for(cfg_.distance));
+        dc.distances(centroids_.data() , nlist_ , dim_ , nullptr , d.data());
+
+        TopKCollector top(min(nprobe , nlist_));
+        top.push_range(d.data() , nlist_ , 0);
+
+        vector<idx_t> probes;
+        for(auto& p : top.sorted_results()) probes.push_back(p.first);
+        return probes;
+    }
+
+    vector<pair<idx_t , dist_t>> IVFIndex::search(const Vector& query , size_t k , size_t nprobe ,
+                                                  const IDSelector* sel) const {
+        assert(query.dim == dim_ && is_trained());
+
+        if(sel) nprobe = filtered_width(nprobe , nlist_ , selectivity(*sel , ntotal_));
+
+        const vector<idx_t> probes = probe_lists(query.raw() , nprobe);
+        DistanceComputer dc(query.raw() , dim_ , cfg_.metric , kernels_for(cfg_.distance));
+
+        auto scan_list = [&] (size_t l , TopKCollector& top) {lists_[l].scan(dc , top , sel);};
 
-        centroids_.clear();
+        TopKCollector top(k);
 
-        // randomly pick k data points to be centroid
-        for(size_t i = 0 ; i<nlist_ ; ++i) centroids_.emplace_back(data[uni(rng)]);
+        if(cfg_.exec == ExecPolicy::OPENMP){
+            #pragma omp parallel num_threads(num_threads(cfg_))
+            {
+                TopKCollector local(k);
 
-        vector<size_t> assignments(data.size());
-        for(size_t iter = 0 ; iter<max_iters ; ++iter){
-            bool changed = false;
-            
+                // lists differ a lot in length, hence dynamic
+                #pragma omp for schedule(dynamic) nowait
+                for(size_t p = 0 ; p<probes.size() ; ++p) scan_list(probes[p] , local);
+
+                #pragma omp critical
+                top.merge(local);
+            }
+        }else{
+            for(idx_t l : probes) scan_list(l , top);
+        }
+
+        return top.sorted_results();
+    }
+
+    vector<pair<idx_t , dist_t>> IVFIndex::range_search(const Vector& query , dist_t radius , size_t nprobe) const {
+        assert(query.dim == dim_ && is_trained());
+
+        const vector<idx_t> probes = probe_lists(query.raw() , nprobe);
+        DistanceComputer dc(query.raw() , dim_ , cfg_.metric , kernels_for(cfg_.distance));
+
+        vector<pair<idx_t , dist_t>> hits;
+
+        if(cfg_.exec == ExecPolicy::OPENMP){
+            #pragma omp parallel num_threads(num_threads(cfg_))
+            {
+                vector<pair<idx_t , dist_t>> local;
+
+                #pragma omp for schedule(dynamic) nowait
+                for(size_t p = 0 ; p<probes.size() ; ++p) lists_[probes[p]].range_scan(dc , radius , local);
+
+                #pragma omp critical
+                hits.insert(hits.end() , local.begin() , local.end());
+            }
+        }else{
+            for(idx_t l : probes) lists_[l].range_scan(dc , radius , hits);
         }
 
-        
+        sort_hits(hits);
+        return hits;
+    }
+
+    RangeSearchResult IVFIndex::range_search(const vector<Vector>& queries , dist_t radius , size_t nprobe) const {
+        return range_search_batch(queries.size() , cfg_ , [&] (size_t q) {return range_search(queries[q] , radius , nprobe);});
     }
-}
\ No newline at end of file
+}
@@ -4,21 +4,63 @@
 
 #include "../core/vector.h"
 #include "../core/distance.h"
+#include "../core/vector_block.h"
+#include "../core/topk.h"
+#include "../core/range_search.h"
+#include "kmeans.h"
+#include "inverted_list.h"
 #include "linear_scan.h"
 
 namespace vdb {
     class IVFIndex{
+        friend class IndexSerializer;   // storage/serialization.h
+
         public:
 
             IVFIndex(dim_t dim , size_t nlist , SearchConfig cfg = {});
 
             void train(const vector<Vector>& data , size_t max_iters = 20);
 
+            // Trains the coarse quantizer on n row-major vectors; see kmeans()
+            // for sampling, seeding and the mini-batch option.
+            void train(const float* data , size_t n , const KMeansConfig& kcfg = {});
+
+            bool is_trained() const {return centroids_.size() == nlist_;}
+
             void add(const Vector& v);
 
-            vector<pair<idx_t , dist_t>> search(const Vector& query , size_t k , size_t nprobe) const;
+            // Bulk ingest of n row-major vectors (e.g. Dataset::data): rows are
+            // assigned in parallel, bucketed per list, and each list reserves
+            // its share once before it is filled.
+            void add_batch(const float* data , size_t n);
+
+            // Copy without the vectors whose remap[id] is NO_ID, the others
+            // renamed to remap[id] (kept ids must map onto 0 .. kept - 1).
+            // Every posting list is rewritten; centroids are shared as is.
+            IVFIndex compacted(const vector<idx_t>& remap) const;
+
+            // Scans the nprobe lists whose centroids are closest to the query
+            // into one shared top-k (per-thread collectors under OPENMP).
+            // cfg.layout picks the posting-list layout (SOA = 8-wide blocks).
+            //
+            // With a selector only member ids are returned, and nprobe is
+            // widened by 1 / selectivity (up to nlist) so the expected number
+            // of scored candidates stays that of the unfiltered search;
+            // rejected ids cost one membership check each.
+            vector<pair<idx_t , dist_t>> search(const Vector& query , size_t k , size_t nprobe ,
+                                                const IDSelector* sel = nullptr) const;
+
+            // All vectors of the nprobe closest lists with distance < radius,
+            // closest first (approximate: hits in other lists are missed).
+            vector<pair<idx_t , dist_t>> range_search(const Vector& query , dist_t radius , size_t nprobe) const;
+
+            // Batch form, packed as CSR (see RangeSearchResult).
+            RangeSearchResult range_search(const vector<Vector>& queries , dist_t radius , size_t nprobe) const;
 
             size_t size() const {return ntotal_;}
+            size_t nlist() const {return nlist_;}
+            size_t list_size(size_t l) const {return lists_[l].size();}
+            const VectorStore& centroids() const {return centroids_;}
 
         private:
 
@@ -27,10 +69,13 @@ namespace vdb {
             SearchConfig cfg_;
             size_t ntotal_ = 0;
 
-            vector<Vector> centroids_;
-            vector<vector<Vector>> lists_;
+            VectorStore centroids_;
+            vector<InvertedList> lists_;
+
+            size_t assign_centroid(VectorView v) const;
 
-            size_t assign_centroid(const Vector& v) const;
+            // ids of the nprobe closest centroids, closest first
+            vector<idx_t> probe_lists(const float* query , size_t nprobe) const;
 
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,303 @@
+#include "ivfpq.h"
+#include <cassert>
+#include <algorithm>
+#include <limits>
+
+#include "../core/parallel.h"
+
+using namespace std;
+
+namespace vdb{
+
+    IVFPQIndex::IVFPQIndex(dim_t dim , size_t nlist , size_t M , SearchConfig cfg , size_t nbits):
+        dim_(dim) , nlist_(nlist) , cfg_(cfg) , centroids_(dim) , pq_(dim , M , cfg , nbits){
+            centroids_.reserve(nlist_);
+            lists_.resize(nlist_);
+        }
+
+    const float* IVFPQIndex::prepare(const float* data , size_t n , vector<float>& buf) const {
+        if(cfg_.metric != Metric::COSINE) return data;
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        buf.assign(data , data + n*dim_);
+
+        #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(cfg_.exec != ExecPolicy::SINGLE_THREAD && n >= 4096)
+        for(size_t i = 0 ; i<n ; ++i){
+            float* x = buf.data() + i*dim_;
+            float nx = norm(x , dim_ , kern);
+            if(nx > 0.0f) for(dim_t d = 0 ; d<dim_ ; ++d) x[d] /= nx;
+        }
+        return buf.data();
+    }
+
+    void IVFPQIndex::train(const float* data , size_t n , const KMeansConfig& kcfg){
+        assert(n >= nlist_ && n >= pq_.ksub());
+
+        vector<float> unit;
+        data = prepare(data , n , unit);
+
+        centroids_ = kmeans(data , n , dim_ , nlist_ , kcfg , cfg_);
+
+        // the sub-quantizer k-means would subsample anyway, so only that
+        // many residuals are formed (an even stride over the data)
+        const size_t cap = kcfg.max_points_per_centroid ? kcfg.max_points_per_centroid * pq_.ksub() : n;
+        const size_t m = min(n , cap);
+        const size_t stride = n / m;
+
+        VectorStore resid(dim_);
+        resid.resize(m);
+        for(size_t i = 0 ; i<m ; ++i) copy(data + i*stride*dim_ , data + (i*stride + 1)*dim_ , resid.row(i));
+
+        vector<idx_t> assign(m);
+        assign_nearest(resid.data() , m , dim_ , centroids_ , assign.data() , nullptr , cfg_);
+        for(size_t i = 0 ; i<m ; ++i){
+            const float* c = centroids_.row(assign[i]);
+            float* r = resid.row(i);
+            for(dim_t d = 0 ; d<dim_ ; ++d) r[d] -= c[d];
+        }
+
+        pq_.train(resid.data() , m , kcfg);
+
+        if(cfg_.metric == Metric::L2) precompute_tables();
+    }
+
+    void IVFPQIndex::precompute_tables(){
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        const size_t M = pq_.M() , ksub = pq_.ksub() , dsub = pq_.dsub();
+
+        // |r|^2 does not depend on the list
+        vector<float> rnorm(M * ksub);
+        for(size_t m = 0 ; m<M ; ++m){
+            const VectorStore& cb = pq_.codebook(m);
+            for(size_t j = 0 ; j<ksub ; ++j) rnorm[m*ksub + j] = kern.inner_product(cb.row(j) , cb.row(j) , dsub);
+        }
+
+        // past the cap every probed list builds its residual table instead
+        if(nlist_ * M * ksub * sizeof(float) > MAX_PRECOMPUTED_BYTES){
+            vector<float>().swap(precomputed_);
+            return;
+        }
+
+        precomputed_.resize(nlist_ * M * ksub);
+
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD;
+        #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(par)
+        for(size_t l = 0 ; l<nlist_ ; ++l){
+            for(size_t m = 0 ; m<M ; ++m){
+                float* t = precomputed_.data() + (l*M + m)*ksub;
+                kern.inner_product_batch(centroids_.row(l) + m*dsub , pq_.codebook(m).data() , ksub , dsub , dsub , t);
+                for(size_t j = 0 ; j<ksub ; ++j) t[j] = rnorm[m*ksub + j] + 2.0f * t[j];
+            }
+        }
+    }
+
+    void IVFPQIndex::add(const Vector& v){
+        assert(v.dim == dim_);
+        add_batch(v.raw() , 1);
+    }
+
+    void IVFPQIndex::add_batch(const float* data , size_t n){
+        assert(is_trained());
+        if(n == 0) return;
+
+        // bounded scratch for residuals and their codes
+        constexpr size_t CHUNK = 16384;
+
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD;
+        const size_t cs = pq_.code_size();
+
+        vector<idx_t> assign(min(n , CHUNK));
+        vector<float> resid(min(n , CHUNK) * dim_);
+        vector<uint8_t> codes(min(n , CHUNK) * cs);
+        vector<float> unit;
+
+        for(size_t base = 0 ; base<n ; base += CHUNK){
+            size_t cnt = min(CHUNK , n - base);
+            const float* rows = prepare(data + base*dim_ , cnt , unit);
+
+            assign_nearest(rows , cnt , dim_ , centroids_ , assign.data() , nullptr , cfg_);
+
+            #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(par && cnt >= 4096)
+            for(size_t i = 0 ; i<cnt ; ++i){
+                const float* x = rows + i*dim_;
+                const float* c = centroids_.row(assign[i]);
+                float* r = resid.data() + i*dim_;
+                for(dim_t d = 0 ; d<dim_ ; ++d) r[d] = x[d] - c[d];
+            }
+
+            pq_.encode_batch(resid.data() , cnt , codes.data());
+
+            for(size_t i = 0 ; i<cnt ; ++i){
+                List& list = lists_[assign[i]];
+                const uint8_t* code = codes.data() + i*cs;
+                size_t pos = list.ids.size();
+
+                list.ids.push_back(static_cast<idx_t>(ntotal_ + base + i));
+                if(pq_.nbits() == 8){
+                    list.codes.insert(list.codes.end() , code , code + cs);
+                }else{
+                    list.codes.resize(pq_.fastscan_size(pos + 1));
+                    pq_.set_fastscan_code(list.codes.data() , pos , code);
+                }
+            }
+        }
+
+        ntotal_ += n;
+    }
+
+    vector<idx_t> IVFPQIndex::probe_lists(const float* query , size_t nprobe) const {
+        vector<dist_t> d(nlist_);
+        DistanceComputer dc(query , dim_ , Metric::L2 , kernels_for(cfg_.distance));
+        dc.distances(centroids_.data() , nlist_ , dim_ , nullptr , d.data());
+
+        TopKCollector top(min(nprobe , nlist_));
+        top.push_range(d.data() , nlist_ , 0);
+
+        vector<idx_t> probes;
+        for(auto& p : top.sorted_results()) probes.push_back(p.first);
+        return probes;
+    }
+
+    vector<pair<idx_t , dist_t>> IVFPQIndex::search(const Vector& query , size_t k , size_t nprobe ,
+                                                    size_t refine_factor , const IDSelector* sel) const {
+        assert(query.dim == dim_ && is_trained());
+
+        if(sel) nprobe = filtered_width(nprobe , nlist_ , selectivity(*sel , ntotal_));
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        vector<float> unit;
+        const float* q = prepare(query.raw() , 1 , unit);
+        const size_t M = pq_.M() , ksub = pq_.ksub() , dsub = pq_.dsub();
+        const bool l2 = cfg_.metric == Metric::L2;
+        const bool per_list = l2 && precomputed_.empty();
+        const bool refine = refine_factor > 0 && raw_;
+        const size_t kk = refine ? k * refine_factor : k;
+
+        const vector<idx_t> probes = probe_lists(q , nprobe);
+
+        // Query table shared by every list: -2<q , r> for L2, the PQ
+        // metric table otherwise. Plus the coarse term of each probe.
+        vector<float> qtable(M * ksub);
+        vector<dist_t> coarse(probes.size());
+
+        if(per_list){
+            // residual tables are built per probed list, see scan_list
+        }else if(l2){
+            for(size_t m = 0 ; m<M ; ++m){
+                float* t = qtable.data() + m*ksub;
+                kern.inner_product_batch(q + m*dsub , pq_.codebook(m).data() , ksub , dsub , dsub , t);
+                for(size_t j = 0 ; j<ksub ; ++j) t[j] *= -2.0f;
+            }
+            for(size_t p = 0 ; p<probes.size() ; ++p) coarse[p] = kern.l2(q , centroids_.row(probes[p]) , dim_);
+        }else{
+            // a COSINE query is unit length already, so 1 - <q , c + r>
+            // splits into the table (which carries the 1) and -<q , c>
+            pq_.compute_distance_table(q , qtable.data());
+            for(size_t p = 0 ; p<probes.size() ; ++p) coarse[p] = -kern.inner_product(q , centroids_.row(probes[p]) , dim_);
+        }
+
+        struct Scratch{
+            vector<float> table;
+            vector<dist_t> dists;
+            ProductQuantizer::FastScanLUT lut;
+            vector<uint8_t> codes;   // compacted codes of a sparse selection
+            vector<idx_t> ids;
+            vector<float> rq;        // residual query, per-list L2 tables only
+        };
+
+        auto scan_list = [&] (size_t p , TopKCollector& top , Scratch& s) {
+            const List& list = lists_[probes[p]];
+            const size_t n = list.ids.size();
+            if(n == 0) return;
+
+            const float* table = qtable.data();
+            dist_t offset = coarse[p];
+            if(per_list){
+                // |(q - c) - r|^2 is the whole distance: no coarse term
+                const float* c = centroids_.row(probes[p]);
+                s.rq.resize(dim_);
+                for(dim_t d = 0 ; d<dim_ ; ++d) s.rq[d] = q[d] - c[d];
+                s.table.resize(M * ksub);
+                pq_.compute_distance_table(s.rq.data() , s.table.data());
+                table = s.table.data();
+                offset = 0.0f;
+            }else if(l2){
+                const float* pre = precomputed_.data() + probes[p]*M*ksub;
+                s.table.resize(M * ksub);
+                for(size_t i = 0 ; i<M*ksub ; ++i) s.table[i] = pre[i] + qtable[i];
+                table = s.table.data();
+            }
+
+            const size_t cs = pq_.code_size();
+            const idx_t* ids = list.ids.data();
+            size_t cnt = n;
+
+            s.dists.resize(n);
+            if(sel){
+                s.ids.clear();
+                for(size_t i = 0 ; i<n ; ++i) if(sel->is_member(ids[i])) s.ids.push_back(static_cast<idx_t>(i));
+                if(s.ids.empty()) return;
+            }
+
+            if(sel && pq_.nbits() == 8 && s.ids.size() * 4 < n){
+                // ADC over just the selected codes
+                cnt = s.ids.size();
+                s.codes.resize(cnt * cs);
+                for(size_t j = 0 ; j<cnt ; ++j){
+                    const uint8_t* c = list.codes.data() + s.ids[j]*cs;
+                    copy(c , c + cs , s.codes.data() + j*cs);
+                    s.ids[j] = ids[s.ids[j]];
+                }
+                pq_.adc_distances(table , s.codes.data() , cnt , s.dists.data());
+                ids = s.ids.data();
+            }else{
+                if(pq_.nbits() == 8){
+                    pq_.adc_distances(table , list.codes.data() , n , s.dists.data());
+                }else{
+                    pq_.quantize_lut(table , s.lut);
+                    pq_.fastscan_distances(s.lut , list.codes.data() , n , s.dists.data());
+                }
+
+                if(sel){
+                    // positions in s.ids are ascending: every gap is rejected
+                    size_t j = 0;
+                    for(size_t i = 0 ; i<n ; ++i){
+                        if(j < s.ids.size() && s.ids[j] == i) ++j;
+                        else s.dists[i] = numeric_limits<dist_t>::infinity();
+                    }
+                }
+            }
+
+            for(size_t i = 0 ; i<cnt ; ++i) s.dists[i] += offset;
+            top.push_ids(s.dists.data() , ids , cnt);
+        };
+
+        TopKCollector top(kk);
+
+        if(cfg_.exec == ExecPolicy::OPENMP){
+            #pragma omp parallel num_threads(num_threads(cfg_))
+            {
+                TopKCollector local(kk);
+                Scratch s;
+
+                #pragma omp for schedule(dynamic) nowait
+                for(size_t p = 0 ; p<probes.size() ; ++p) scan_list(p , local , s);
+
+                #pragma omp critical
+                top.merge(local);
+            }
+        }else{
+            Scratch s;
+            for(size_t p = 0 ; p<probes.size() ; ++p) scan_list(p , top , s);
+        }
+
+        if(!refine) return top.sorted_results();
+
+        // exact re-rank of the PQ shortlist
+        DistanceComputer dc(q , dim_ , cfg_.metric , kern);
+        TopKCollector exact(k);
+        for(auto& c : top.sorted_results()) exact.push(c.first , dc(raw_->row(c.first)));
+
+        return exact.sorted_results();
+    }
+}
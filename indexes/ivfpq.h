@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "../core/vector.h"
+#include "../core/distance.h"
+#include "../core/vector_block.h"
+#include "../core/topk.h"
+#include "../core/id_selector.h"
+#include "kmeans.h"
+#include "pq.h"
+
+namespace vdb {
+
+    // IVF coarse quantizer + PQ codes of the residuals (x minus its list's
+    // centroid). Only code_size() bytes and an id are stored per vector.
+    //
+    // For L2 the distance to a code splits into
+    //   |q - c|^2  +  (|r|^2 + 2<c , r>)  -  2<q , r>
+    // The first term is the coarse distance, the second depends only on
+    // the list and is precomputed per list at train time (nlist x M x ksub
+    // floats), the third is one table per query shared by all lists, so a
+    // list costs M x ksub adds instead of a fresh residual table. Past
+    // MAX_PRECOMPUTED_BYTES (nlist = 65536 , M = 64 would take 4 GiB) no
+    // tables are kept and each probed list builds the L2 table of the
+    // residual query q - c instead. For INNER_PRODUCT / COSINE <q , c + r>
+    // needs no per-list table at all.
+    //
+    // Under COSINE, training data, added vectors and queries are
+    // normalized on the way in, so the PQ scores unit vectors.
+    //
+    // Search can re-rank the best k * refine_factor candidates with exact
+    // distances from a raw vector store (set_refine_store).
+    class IVFPQIndex{
+        public:
+            static constexpr size_t MAX_PRECOMPUTED_BYTES = size_t(256) << 20;
+
+            IVFPQIndex(dim_t dim , size_t nlist , size_t M , SearchConfig cfg = {} , size_t nbits = 8);
+
+            // Coarse k-means, then the PQ on residuals of (a sample of) the data.
+            void train(const float* data , size_t n , const KMeansConfig& kcfg = {});
+
+            bool is_trained() const {return centroids_.size() == nlist_ && pq_.is_trained();}
+
+            void add(const Vector& v);
+            void add_batch(const float* data , size_t n);
+
+            // Row i of raw must be the vector added with id i; the store is
+            // not owned (it may be memory mapped) and must outlive searches.
+            void set_refine_store(const VectorStore* raw) {raw_ = raw;}
+
+            // refine_factor = 0 returns PQ distances; otherwise the top
+            // k * refine_factor PQ candidates are re-scored exactly. A
+            // selector widens nprobe as in IVFIndex::search; with 8-bit codes
+            // a sparse selection has its codes compacted before the ADC scan.
+            vector<pair<idx_t , dist_t>> search(const Vector& query , size_t k , size_t nprobe ,
+                                                size_t refine_factor = 0 , const IDSelector* sel = nullptr) const;
+
+            size_t size() const {return ntotal_;}
+            size_t nlist() const {return nlist_;}
+            size_t list_size(size_t l) const {return lists_[l].ids.size();}
+            const VectorStore& centroids() const {return centroids_;}
+            const ProductQuantizer& pq() const {return pq_;}
+
+        private:
+
+            // 8-bit lists hold size x code_size() bytes; 4-bit lists hold
+            // the fast-scan blocks of pack_fastscan.
+            struct List{
+                vector<uint8_t> codes;
+                vector<idx_t> ids;
+            };
+
+            dim_t dim_;
+            size_t nlist_;
+            SearchConfig cfg_;
+            size_t ntotal_ = 0;
+
+            VectorStore centroids_;
+            ProductQuantizer pq_;
+            vector<List> lists_;
+
+            vector<float> precomputed_;   // L2 only: nlist x M x ksub, |r|^2 + 2<c , r>; empty past the cap
+            const VectorStore* raw_ = nullptr;
+
+            void precompute_tables();
+
+            // copies of n rows normalized to unit length into buf under
+            // COSINE; data itself otherwise
+            const float* prepare(const float* data , size_t n , vector<float>& buf) const;
+
+            vector<idx_t> probe_lists(const float* query , size_t nprobe) const;
+    };
+}
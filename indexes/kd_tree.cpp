@@ -1,105 +1,236 @@
 #include "kd_tree.h"
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <limits>
 
 #include "../core/distance.h"
+#include "../core/parallel.h"
 using namespace std;
 
 namespace vdb{
-    KDTree::KDTree(size_t dim) : dim_(dim) , data_(nullptr) {}
+    KDTree::KDTree(size_t dim , SearchConfig cfg , size_t leaf_size) :
+        dim_(dim) , cfg_(cfg) , leaf_size_(min(max<size_t>(leaf_size , 1) , MAX_LEAF)) , data_(dim) {}
 
     void KDTree::build(const vector<Vector>& data){
-        data_ = &data;
-        vector<size_t> indices(data.size());
-        for(size_t i = 0; i<data.size() ; i++){
-            indices[i] = i;
+        VectorStore rows(dim_);
+        rows.reserve(data.size());
+        for(const auto& v : data) rows.append(v.raw());
+
+        build(rows.data() , rows.size());
+    }
+
+    void KDTree::build(const float* data , size_t n){
+        vector<idx_t> perm(n);
+        for(size_t i = 0 ; i<n ; ++i) perm[i] = static_cast<idx_t>(i);
+
+        // smallest depth whose leaves hold at most leaf_size points
+        depth_ = 0;
+        while(((n + (size_t(1) << depth_) - 1) >> depth_) > leaf_size_) ++depth_;
+
+        data_.clear();
+        data_.resize(n);
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD;
+
+        #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(par)
+        for(size_t i = 0 ; i<n ; ++i) copy(data + i*dim_ , data + (i+1)*dim_ , data_.row(i));
+
+        build_tree(perm);
+
+        // move every point next to the rest of its leaf
+        VectorStore ordered(dim_);
+        ordered.resize(n);
+        ids_.assign(perm.begin() , perm.end());
+        rows_.assign(n , 0);
+
+        #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(par)
+        for(size_t r = 0 ; r<n ; ++r){
+            copy(data_.row(perm[r]) , data_.row(perm[r]) + dim_ , ordered.row(r));
+            rows_[perm[r]] = static_cast<idx_t>(r);
         }
 
-        root_ = build_recursive(indices , 0);
+        data_ = move(ordered);
     }
 
-    unique_ptr<KDTree::Node> KDTree::build_recursive(vector<size_t>& indices , size_t depth){
-        if(indices.empty()) return nullptr;
+    void KDTree::build_tree(vector<idx_t>& perm){
+        constexpr size_t SPREAD_SAMPLE = 256;
 
-        size_t axis = depth%dim_;
-        size_t mid = indices.size() / 2;
+        nodes_.assign((size_t(1) << depth_) - 1 , Node{0.0f , 0});
 
-        nth_element(indices.begin(),
-                    indices.begin() + mid , 
-                    indices.end(),
-                    [&](size_t a , size_t b){
-                        return (*data_)[a].data[axis] < (*data_)[b].data[axis];
-                });
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD;
+
+        // ranges of the nodes of the current level, left to right
+        vector<pair<size_t , size_t>> ranges{{0 , perm.size()}};
+
+        for(size_t level = 0 ; level<depth_ ; ++level){
+            const size_t first = (size_t(1) << level) - 1;
+            vector<pair<size_t , size_t>> next(2 * ranges.size());
 
-        auto node = make_unique<Node>();
-        node -> index = indices[mid];
-        node -> axis = axis;
-        node -> split = (*data_)[node->index].data[axis];
+            #pragma omp parallel for schedule(dynamic , 1) num_threads(num_threads(cfg_)) if(par && ranges.size() > 1)
+            for(size_t j = 0 ; j<ranges.size() ; ++j){
+                const size_t b = ranges[j].first , e = ranges[j].second;
+                const size_t m = b + (e - b) / 2;
 
-        vector<size_t> left(indices.begin() , indices.begin() + mid);
-        vector<size_t> right(indices.begin() + mid + 1 , indices.end());
+                // widest axis of the range, estimated on a strided sample
+                const size_t step = max<size_t>(1 , (e - b) / SPREAD_SAMPLE);
+                vector<float> lo(data_.row(perm[b]) , data_.row(perm[b]) + dim_) , hi = lo;
+                for(size_t i = b + step ; i<e ; i += step){
+                    const float* x = data_.row(perm[i]);
+                    for(size_t d = 0 ; d<dim_ ; ++d){
+                        lo[d] = min(lo[d] , x[d]);
+                        hi[d] = max(hi[d] , x[d]);
+                    }
+                }
+                size_t axis = 0;
+                for(size_t d = 1 ; d<dim_ ; ++d) if(hi[d] - lo[d] > hi[axis] - lo[axis]) axis = d;
+
+                nth_element(perm.begin() + b , perm.begin() + m , perm.begin() + e , [&] (idx_t x , idx_t y) {
+                    return data_.row(x)[axis] < data_.row(y)[axis];
+                });
 
-        node -> left = build_recursive(left , depth + 1);
-        node -> right = build_recursive(right , depth + 1);
+                nodes_[first + j] = Node{data_.row(perm[m])[axis] , static_cast<uint32_t>(axis)};
+                next[2*j] = {b , m};
+                next[2*j + 1] = {m , e};
+            }
 
-        return node;
+            ranges = move(next);
+        }
+    }
+
+    void KDTree::score_leaf(const float* query , const DistanceKernels& kern , size_t begin , size_t end ,
+                            dist_t bound , dist_t* out) const {
+        // long rows stop early against the bound (see bounded_kernel_t),
+        // short ones go through the fused batch kernel
+        if(dim_ >= 4 * L2_ABANDON_STEP){
+            for(size_t r = begin ; r<end ; ++r) out[r - begin] = kern.l2_bounded(query , data_.row(r) , dim_ , bound);
+        }else{
+            kern.l2_batch(query , data_.row(begin) , end - begin , dim_ , dim_ , out);
+        }
     }
 
     void KDTree::search(
-        const Vector& query , 
+        const Vector& query ,
         size_t k,
         vector<size_t>& out_indices,
-        vector<size_t>& out_distances,
-        KDTreeStats* stats
+        vector<dist_t>& out_distances,
+        KDTreeStats* stats,
+        const IDSelector* sel
     )const {
-        
-        priority_queue<pair<float, size_t>> heap;
+        constexpr size_t DIRECT_RATIO = 16;
+
+        assert(query.dim == dim_);
+
+        TopKCollector top(k);
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
 
         if(stats) *stats = KDTreeStats{};
 
-        search_recursive(root_.get() , query , k , heap , stats);
+        vector<idx_t> allowed;
+        const size_t n = data_.size();
+        const size_t c = sel ? sel->count(n) : IDSelector::UNKNOWN;
 
-        size_t n = heap.size();
-        out_distances.resize(n);
-        out_indices.resize(n);
+        if(c != IDSelector::UNKNOWN && c < n / DIRECT_RATIO && sel->members(n , allowed)){
+            for(idx_t id : allowed) top.push(id , kern.l2(data_.row(rows_[id]) , query.raw() , dim_));
+        }else if(n > 0){
+            Walk w{query.raw() , kern , vector<float>(dim_ , 0.0f) , stats};
+            search_node(0 , 0 , n , 0 , 0.0f , w , top , sel);
+        }
 
-        for(size_t i = 0 ; i<n ; i++){
-            out_indices[n-1-i] = heap.top().second;
-            out_distances[n-1-i] = heap.top().first;
-            heap.pop();
+        auto results = top.sorted_results();
+        out_distances.resize(results.size());
+        out_indices.resize(results.size());
+
+        for(size_t i = 0 ; i<results.size() ; i++){
+            out_indices[i] = results[i].first;
+            out_distances[i] = results[i].second;
         }
     }
 
-    void KDTree::search_recursive(
-        const Node* node,
-        const Vector& query,
-        size_t k,
-        priority_queue<pair<float , size_t>>& heap ,
-        KDTreeStats* stats 
-    ) const {
-        if(!node) return ;
+    void KDTree::search_node(size_t node , size_t begin , size_t end , size_t level , float rd ,
+                             Walk& w , TopKCollector& top , const IDSelector* sel) const {
+        if(w.stats) w.stats->visited_nodes++;
 
-        if(stats) stats->visited_nodes++;
+        if(level == depth_){
+            dist_t out[MAX_LEAF];
+            score_leaf(w.query , w.kern , begin , end , top.threshold() , out);
+            if(sel) for(size_t r = begin ; r<end ; ++r) if(!sel->is_member(ids_[r])) out[r - begin] = numeric_limits<dist_t>::infinity();
+            top.push_ids(out , ids_.data() + begin , end - begin);
+            return;
+        }
 
-        float dist = l2_distance((*data_)[node->index] , query);
+        const Node& nd = nodes_[node];
+        const size_t mid = begin + (end - begin) / 2;
+        const float diff = w.query[nd.axis] - nd.split;
+
+        // near child first; the far one only if its cell can still hold a
+        // point closer than the current k-th
+        if(diff < 0.0f) search_node(2*node + 1 , begin , mid , level + 1 , rd , w , top , sel);
+        else            search_node(2*node + 2 , mid , end , level + 1 , rd , w , top , sel);
+
+        float& off = w.off[nd.axis];
+        const float old = off;
+        const float far_rd = rd - old*old + diff*diff;
+
+        if(far_rd < top.threshold()){
+            off = diff;
+            if(diff < 0.0f) search_node(2*node + 2 , mid , end , level + 1 , far_rd , w , top , sel);
+            else            search_node(2*node + 1 , begin , mid , level + 1 , far_rd , w , top , sel);
+            off = old;
+        }else if(w.stats){
+            w.stats->pruned_branches++;
+        }
+    }
 
-        if(heap.size() < k) heap.emplace(dist , node->index);
-        else if(heap.top().first > dist) {heap.pop() ; heap.emplace(dist , node->index);}
+    vector<pair<idx_t , dist_t>> KDTree::range_search(const Vector& query , dist_t radius , KDTreeStats* stats) const {
+        assert(query.dim == dim_);
 
-        float diff = query.data[node->axis] - node->split;
-        const Node* near = diff <= 0 ? node->left.get() : node->right.get();
-        const Node* far = diff<=0 ? node->right.get() : node->left.get();
+        vector<pair<idx_t , dist_t>> hits;
 
-        search_recursive(near , query , k , heap , stats);
+        if(stats) *stats = KDTreeStats{};
 
-        float worst = heap.size() < k ? numeric_limits<float>::infinity()
-                                      : heap.top().first; 
-        
-        if(diff*diff < worst) search_recursive(far , query , k , heap , stats);
+        if(data_.size() > 0){
+            Walk w{query.raw() , kernels_for(cfg_.distance) , vector<float>(dim_ , 0.0f) , stats};
+            range_node(0 , 0 , data_.size() , 0 , 0.0f , w , radius , hits);
+        }
+
+        sort_hits(hits);
+        return hits;
+    }
+
+    RangeSearchResult KDTree::range_search(const vector<Vector>& queries , dist_t radius) const {
+        return range_search_batch(queries.size() , cfg_ , [&] (size_t q) {return range_search(queries[q] , radius);});
+    }
+
+    void KDTree::range_node(size_t node , size_t begin , size_t end , size_t level , float rd ,
+                            Walk& w , dist_t radius , vector<pair<idx_t , dist_t>>& hits) const {
+        if(w.stats) w.stats->visited_nodes++;
+
+        if(level == depth_){
+            dist_t out[MAX_LEAF];
+            score_leaf(w.query , w.kern , begin , end , radius , out);
+            for(size_t r = begin ; r<end ; ++r) if(out[r - begin] < radius) hits.emplace_back(ids_[r] , out[r - begin]);
+            return;
+        }
 
-        else{
-            if(stats) stats->pruned_branches++;
+        const Node& nd = nodes_[node];
+        const size_t mid = begin + (end - begin) / 2;
+        const float diff = w.query[nd.axis] - nd.split;
+
+        if(diff < 0.0f) range_node(2*node + 1 , begin , mid , level + 1 , rd , w , radius , hits);
+        else            range_node(2*node + 2 , mid , end , level + 1 , rd , w , radius , hits);
+
+        // unlike top-k, the bound is fixed, so this needs no result of the near side
+        float& off = w.off[nd.axis];
+        const float old = off;
+        const float far_rd = rd - old*old + diff*diff;
+
+        if(far_rd < radius){
+            off = diff;
+            if(diff < 0.0f) range_node(2*node + 2 , mid , end , level + 1 , far_rd , w , radius , hits);
+            else            range_node(2*node + 1 , begin , mid , level + 1 , far_rd , w , radius , hits);
+            off = old;
+        }else if(w.stats){
+            w.stats->pruned_branches++;
         }
     }
-}
\ No newline at end of file
+}
@@ -1,57 +1,111 @@
 #pragma once
 #include <vector>
-#include <queue>
-#include <memory>
 #include <cstddef>
+#include <cstdint>
 
 #include "../core/vector.h"
+#include "../core/vector_block.h"
+#include "../core/cpu_dispatch.h"
+#include "../core/topk.h"
+#include "../core/id_selector.h"
+#include "../core/range_search.h"
 using namespace std;
 
 namespace vdb {
 
     struct KDTreeStats{
-        size_t visited_nodes;
+        size_t visited_nodes;     // internal nodes and leaves entered
         size_t pruned_branches;
     };
 
+    // Exact (squared L2) KD-tree with leaf buckets.
+    //
+    // The tree is a complete binary tree in implicit heap order: node i has
+    // children 2i+1 and 2i+2, and an internal node is just (split , axis)
+    // in one flat array. Each node halves its point range at the median
+    // of its widest axis, so a node's range follows from the path to it
+    // and is never stored. Leaves hold at most leaf_size points, which
+    // are reordered at build time to sit contiguously in data_, so a
+    // leaf is one batched kernel call over adjacent rows.
+    //
+    // Search bounds a subtree by the distance from the query to its cell
+    // (per-axis offsets, updated incrementally), which prunes far more
+    // than the distance to the last splitting plane alone.
     class KDTree{
+        friend class IndexSerializer;   // storage/serialization.h
+
         public:
-            explicit KDTree(size_t dim);
+            static constexpr size_t MAX_LEAF = 256;
+
+            explicit KDTree(size_t dim , SearchConfig cfg = {} , size_t leaf_size = 32);
 
+            // Copies the points into the tree's own arena.
             void build(const vector<Vector>& data);
 
+            // Bulk form for n row-major vectors (e.g. Dataset::data); this is
+            // the KD-tree's add_batch, since the tree is built in one shot.
+            // Ranges are partitioned in place (nth_element on one index
+            // array), one tree level at a time with the nodes of a level
+            // spread across threads.
+            void build(const float* data , size_t n);
+
+            // With a selector only member ids are reported; rejected points
+            // of a scanned leaf are skipped. A small enumerable allowed set
+            // is scored directly without the tree.
             void search(const Vector& query,
                         size_t k,
                         vector<size_t>& out_indices,
-                        vector<size_t>& out_distances,
-                        KDTreeStats* stats = nullptr
+                        vector<dist_t>& out_distances,
+                        KDTreeStats* stats = nullptr,
+                        const IDSelector* sel = nullptr
                     )const;
 
+            // All points with (squared L2) distance < radius, closest first.
+            // Subtrees whose cell is radius or more away are pruned.
+            vector<pair<idx_t , dist_t>> range_search(const Vector& query , dist_t radius ,
+                                                      KDTreeStats* stats = nullptr) const;
+
+            // Batch form, packed as CSR (see RangeSearchResult).
+            RangeSearchResult range_search(const vector<Vector>& queries , dist_t radius) const;
+
+            size_t size() const {return data_.size();}
+            size_t depth() const {return depth_;}
+
         private:
             struct Node{
-                size_t index;
-                size_t axis;
                 float split;
-                unique_ptr<Node> left;
-                unique_ptr<Node> right;
+                uint32_t axis;
             };
 
-            unique_ptr<Node> build_recursive(
-                vector<size_t>& indices,
-                size_t depth
-            );
+            // State of one traversal; off[d] is the query's offset from the
+            // current cell along d, rd their squared sum.
+            struct Walk{
+                const float* query;
+                const DistanceKernels& kern;
+                vector<float> off;
+                KDTreeStats* stats;
+            };
 
-            void search_recursive(
-                const Node* node, 
-                const Vector& query,
-                size_t k,
-                priority_queue<pair<float , size_t>>& heap ,
-                KDTreeStats* stats
-            ) const;
+            void build_tree(vector<idx_t>& perm);
+
+            void search_node(size_t node , size_t begin , size_t end , size_t level , float rd ,
+                             Walk& w , TopKCollector& top , const IDSelector* sel) const;
+
+            void range_node(size_t node , size_t begin , size_t end , size_t level , float rd ,
+                            Walk& w , dist_t radius , vector<pair<idx_t , dist_t>>& hits) const;
+
+            // Scores leaf rows [begin , end) into out.
+            void score_leaf(const float* query , const DistanceKernels& kern , size_t begin , size_t end ,
+                            dist_t bound , dist_t* out) const;
 
-        private:
             size_t dim_;
-            const vector<Vector>* data_;
-            unique_ptr<Node> root_;
+            SearchConfig cfg_;
+            size_t leaf_size_;
+            size_t depth_ = 0;            // levels of internal nodes
+
+            VectorStore data_;            // points in leaf order
+            MappedVector<idx_t> ids_;     // original id of each row of data_
+            MappedVector<idx_t> rows_;    // row of each original id
+            MappedVector<Node> nodes_;    // 2^depth - 1 internal nodes, heap order
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,278 @@
+#include "kmeans.h"
+#include <random>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../core/parallel.h"
+
+using namespace std;
+
+namespace vdb {
+
+    void assign_nearest(const float* data , size_t n , dim_t dim ,
+                        const VectorStore& centroids ,
+                        idx_t* labels , dist_t* dists ,
+                        const SearchConfig& cfg){
+        constexpr size_t L = VectorBlock::LANES;
+        constexpr size_t MR = TILE_QUERIES;
+        constexpr size_t POINT_BLOCK = 64;
+        constexpr size_t TILE_BYTES = 256 * 1024;
+
+        const size_t k = centroids.size();
+        if(n == 0 || k == 0) return;
+
+        const DistanceKernels& kern = kernels_for(cfg.distance);
+
+        VectorBlock packed(0 , dim);
+        packed.resize(k);
+        vector<float> cnorms(k);
+        for(size_t c = 0 ; c<k ; ++c){
+            packed.set(c , centroids.row(c));
+            cnorms[c] = kern.inner_product(centroids.row(c) , centroids.row(c) , dim);
+        }
+
+        const size_t total_blocks = packed.num_blocks();
+        const size_t tile_blocks = max<size_t>(1 , TILE_BYTES / (dim * L * sizeof(float)));
+        const size_t n_pblocks = (n + POINT_BLOCK - 1) / POINT_BLOCK;
+        const bool par = cfg.exec != ExecPolicy::SINGLE_THREAD && n >= 1024;
+
+        #pragma omp parallel num_threads(num_threads(cfg)) if(par)
+        {
+            vector<float> dots(MR * tile_blocks * L);
+            float best_d[POINT_BLOCK];
+            idx_t best_c[POINT_BLOCK];
+
+            #pragma omp for schedule(dynamic , 4)
+            for(size_t pb = 0 ; pb<n_pblocks ; ++pb){
+                const size_t p0 = pb * POINT_BLOCK;
+                const size_t p1 = min(n , p0 + POINT_BLOCK);
+
+                fill(best_d , best_d + POINT_BLOCK , numeric_limits<float>::infinity());
+                fill(best_c , best_c + POINT_BLOCK , 0);
+
+                // ||c||^2 - 2 x.c ranks centroids; ||x||^2 is added at the end
+                for(size_t tb = 0 ; tb<total_blocks ; tb += tile_blocks){
+                    const size_t nb = min(tile_blocks , total_blocks - tb);
+                    const size_t c0 = tb * L;
+                    const size_t cnt = min(nb * L , k - c0);
+                    const size_t ld = nb * L;
+
+                    for(size_t p = p0 ; p<p1 ; p += MR){
+                        const float* qp[MR];
+                        for(size_t r = 0 ; r<MR ; ++r) qp[r] = data + min(p + r , p1 - 1) * dim;
+
+                        kern.inner_product_tile(qp , packed.block(tb) , nb , dim , dots.data() , ld);
+
+                        for(size_t r = 0 ; r<MR && p + r<p1 ; ++r){
+                            const float* dot = dots.data() + r * ld;
+                            float& bd = best_d[p + r - p0];
+                            idx_t& bc = best_c[p + r - p0];
+                            for(size_t j = 0 ; j<cnt ; ++j){
+                                float d = cnorms[c0 + j] - 2.0f * dot[j];
+                                if(d < bd){bd = d ; bc = static_cast<idx_t>(c0 + j);}
+                            }
+                        }
+                    }
+                }
+
+                for(size_t p = p0 ; p<p1 ; ++p){
+                    labels[p] = best_c[p - p0];
+                    if(dists){
+                        const float* x = data + p * dim;
+                        dists[p] = max(0.0f , kern.inner_product(x , x , dim) + best_d[p - p0]);
+                    }
+                }
+            }
+        }
+    }
+
+    namespace {
+
+        // k-means++: each next seed is drawn with probability proportional
+        // to its squared distance from the seeds picked so far.
+        VectorStore kmeanspp_seed(const VectorStore& pts , size_t k , mt19937& rng , const SearchConfig& cfg){
+            const size_t n = pts.size();
+            const dim_t dim = pts.dim();
+            const DistanceKernels& kern = kernels_for(cfg.distance);
+            const bool par = cfg.exec != ExecPolicy::SINGLE_THREAD;
+
+            VectorStore seeds(dim);
+            seeds.reserve(k);
+            seeds.append(pts.row(uniform_int_distribution<size_t>(0 , n - 1)(rng)));
+
+            vector<float> d2(n);
+            #pragma omp parallel for schedule(static) num_threads(num_threads(cfg)) if(par)
+            for(size_t i = 0 ; i<n ; ++i) d2[i] = kern.l2(pts.row(i) , seeds.row(0) , dim);
+
+            uniform_real_distribution<double> uni(0.0 , 1.0);
+            while(seeds.size() < k){
+                double total = 0.0;
+                for(float d : d2) total += d;
+
+                size_t pick = n - 1;
+                if(total > 0.0){
+                    // rows at distance 0 (the seeds among them) are never
+                    // picked, even for target 0 or a rounded-off total
+                    double target = uni(rng) * total , acc = 0.0;
+                    for(size_t i = 0 ; i<n ; ++i){
+                        if(d2[i] <= 0.0f) continue;
+                        acc += d2[i];
+                        pick = i;
+                        if(acc > target) break;
+                    }
+                }else{
+                    pick = uniform_int_distribution<size_t>(0 , n - 1)(rng);
+                }
+
+                seeds.append(pts.row(pick));
+                const float* c = pts.row(pick);
+
+                #pragma omp parallel for schedule(static) num_threads(num_threads(cfg)) if(par)
+                for(size_t i = 0 ; i<n ; ++i) d2[i] = min(d2[i] , kern.l2(pts.row(i) , c , dim));
+            }
+
+            return seeds;
+        }
+
+        // Copies a random subset of m rows (all rows when m >= n).
+        VectorStore sample_rows(const float* data , size_t n , dim_t dim , size_t m , mt19937& rng){
+            VectorStore out(dim);
+            if(m >= n){
+                out.resize(n);
+                copy(data , data + n * dim , out.data());
+                return out;
+            }
+
+            vector<size_t> perm(n);
+            iota(perm.begin() , perm.end() , 0);
+            for(size_t i = 0 ; i<m ; ++i) swap(perm[i] , perm[uniform_int_distribution<size_t>(i , n - 1)(rng)]);
+            sort(perm.begin() , perm.begin() + m);   // keeps the copy a forward sweep
+
+            out.resize(m);
+            for(size_t i = 0 ; i<m ; ++i) copy(data + perm[i] * dim , data + (perm[i] + 1) * dim , out.row(i));
+            return out;
+        }
+
+        // Per-thread partial sums, reduced into sums/counts.
+        void accumulate(const VectorStore& pts , size_t m , const idx_t* labels ,
+                        size_t k , vector<double>& sums , vector<size_t>& counts , const SearchConfig& cfg){
+            const dim_t dim = pts.dim();
+            const bool par = cfg.exec != ExecPolicy::SINGLE_THREAD && m >= 1024;
+
+            fill(sums.begin() , sums.end() , 0.0);
+            fill(counts.begin() , counts.end() , 0);
+
+            #pragma omp parallel num_threads(num_threads(cfg)) if(par)
+            {
+                vector<double> ls(k * dim , 0.0);
+                vector<size_t> lc(k , 0);
+
+                #pragma omp for schedule(static) nowait
+                for(size_t j = 0 ; j<m ; ++j){
+                    const float* x = pts.row(j);
+                    idx_t c = labels[j];
+                    lc[c]++;
+                    double* s = ls.data() + c * dim;
+                    for(dim_t d = 0 ; d<dim ; ++d) s[d] += x[d];
+                }
+
+                #pragma omp critical
+                {
+                    for(size_t i = 0 ; i<ls.size() ; ++i) sums[i] += ls[i];
+                    for(size_t c = 0 ; c<k ; ++c) counts[c] += lc[c];
+                }
+            }
+        }
+    }
+
+    VectorStore kmeans(const float* data , size_t n , dim_t dim , size_t k ,
+                       const KMeansConfig& kcfg , const SearchConfig& cfg){
+        assert(n >= k && k > 0);
+
+        mt19937 rng(kcfg.seed);
+
+        const size_t cap = kcfg.max_points_per_centroid ? kcfg.max_points_per_centroid * k : n;
+        VectorStore pts = sample_rows(data , n , dim , cap , rng);
+        const size_t m = pts.size();
+
+        VectorStore centroids = [&] {
+            size_t seed_n = max(k , kcfg.seed_points_per_centroid * k);
+            if(seed_n >= m) return kmeanspp_seed(pts , k , rng , cfg);
+            VectorStore sub = sample_rows(pts.data() , m , dim , seed_n , rng);
+            return kmeanspp_seed(sub , k , rng , cfg);
+        }();
+
+        vector<double> sums(k * dim);
+        vector<size_t> counts(k);
+
+        if(kcfg.batch_size == 0 || kcfg.batch_size >= m){
+            // Lloyd: assign every sample point, move centroids to the means
+            vector<idx_t> labels(m) , prev(m , numeric_limits<idx_t>::max());
+
+            for(size_t iter = 0 ; iter<kcfg.max_iters ; ++iter){
+                assign_nearest(pts.data() , m , dim , centroids , labels.data() , nullptr , cfg);
+                if(labels == prev) break;
+                prev = labels;
+
+                accumulate(pts , m , labels.data() , k , sums , counts , cfg);
+
+                for(size_t c = 0 ; c<k ; ++c){
+                    if(counts[c] == 0) continue;
+                    float* ctr = centroids.row(c);
+                    for(dim_t d = 0 ; d<dim ; ++d) ctr[d] = static_cast<float>(sums[c * dim + d] / counts[c]);
+                }
+
+                // An empty cluster takes over half of the largest one: copy
+                // its centroid and nudge the two apart.
+                for(size_t c = 0 ; c<k ; ++c){
+                    if(counts[c] != 0) continue;
+                    size_t big = max_element(counts.begin() , counts.end()) - counts.begin();
+                    float* dst = centroids.row(c);
+                    float* src = centroids.row(big);
+                    for(dim_t d = 0 ; d<dim ; ++d){
+                        float eps = (d % 2 ? 1.0f : -1.0f) * 1e-4f * (fabs(src[d]) + 1e-6f);
+                        dst[d] = src[d] + eps;
+                        src[d] -= eps;
+                    }
+                    counts[big] /= 2;
+                    counts[c] = counts[big];
+                }
+            }
+        }else{
+            // Mini-batch (Sculley): each centroid moves towards the batch mean
+            // of its points with a step of batch_count / total_count seen.
+            const size_t b = kcfg.batch_size;
+            vector<size_t> seen(k , 0);
+            VectorStore batch(dim);
+            batch.resize(b);
+            vector<idx_t> labels(b);
+
+            uniform_int_distribution<size_t> pick(0 , m - 1);
+            for(size_t iter = 0 ; iter<kcfg.max_iters ; ++iter){
+                for(size_t j = 0 ; j<b ; ++j){
+                    const float* x = pts.row(pick(rng));
+                    copy(x , x + dim , batch.row(j));
+                }
+
+                assign_nearest(batch.data() , b , dim , centroids , labels.data() , nullptr , cfg);
+                accumulate(batch , b , labels.data() , k , sums , counts , cfg);
+
+                for(size_t c = 0 ; c<k ; ++c){
+                    if(counts[c] == 0) continue;
+                    seen[c] += counts[c];
+                    float eta = static_cast<float>(counts[c]) / seen[c];
+                    float* ctr = centroids.row(c);
+                    for(dim_t d = 0 ; d<dim ; ++d){
+                        float mean = static_cast<float>(sums[c * dim + d] / counts[c]);
+                        ctr[d] += eta * (mean - ctr[d]);
+                    }
+                }
+            }
+        }
+
+        return centroids;
+    }
+}
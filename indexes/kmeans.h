@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "../core/vector_block.h"
+#include "../core/distance.h"
+
+using namespace std;
+
+namespace vdb {
+
+    struct KMeansConfig{
+        size_t max_iters = 20;
+        size_t batch_size = 0;                  // mini-batch size, 0 = full Lloyd iterations
+        size_t max_points_per_centroid = 256;   // training sample cap per centroid, 0 = use all
+        size_t seed_points_per_centroid = 8;    // k-means++ seeding runs on this many per centroid
+        uint32_t seed = 64;
+    };
+
+    // Clusters n row-major vectors into k centroids: k-means++ seeding on a
+    // subsample, then Lloyd (or mini-batch, if batch_size is set) iterations
+    // over a random training sample. Assignment uses assign_nearest, and
+    // with an OPENMP exec policy both steps run on all threads.
+    VectorStore kmeans(const float* data , size_t n , dim_t dim , size_t k ,
+                       const KMeansConfig& kcfg = {} , const SearchConfig& cfg = {});
+
+    // Nearest centroid (squared L2) for each of n row-major vectors. The
+    // centroids are packed once into the blocked layout and scored with
+    // the GEMM tile kernel, four points per call. dists may be null.
+    void assign_nearest(const float* data , size_t n , dim_t dim ,
+                        const VectorStore& centroids ,
+                        idx_t* labels , dist_t* dists ,
+                        const SearchConfig& cfg = {});
+}
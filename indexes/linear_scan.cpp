@@ -2,70 +2,527 @@
 
 #include <bits/stdc++.h>
 #include <cassert>
-#include <omp.h>
+
+#include "../core/parallel.h"
 
 using namespace std;
 
 namespace vdb {
-    LinearScanIndex::LinearScanIndex(dim_t dim , SearchConfig cfg) : dim_(dim), cfg_(cfg) , soa_(0, dim) {}
+    LinearScanIndex::LinearScanIndex(dim_t dim , SearchConfig cfg) : dim_(dim), cfg_(cfg) , aos_(dim) , soa_(0, dim) , sq_(dim , cfg.encoding) {
+        // the re-rank reads single rows, so BINARY keeps them AOS
+        if(binary()) cfg_.layout = LayoutType::AOS;
+    }
 
     void LinearScanIndex::add(const Vector& v){
         assert (v.dim == dim_);
 
-        aos_.push_back(v);
+        // SOA keeps only the blocked copy so the scan never touches aos_,
+        // a compressed encoding only the codes (BINARY the rows as well)
+        if(encoded()){
+            assert(is_trained());
+            const size_t at = codes_.size();
+            codes_.resize(at + sq_.code_size());
+            sq_.encode(v.raw() , codes_.data() + at);
+            if(binary()) aos_.append(v.raw());
+        }else if(cfg_.layout == LayoutType::SOA) soa_.append(v.raw());
+        else aos_.append(v.raw());
 
-        if(cfg_.layout == LayoutType::SOA) {
-            if(soa_.size == 0) soa_ = VectorBlock(1 , dim_);
-            else{
-                soa_.data.resize((soa_.size + 1) * dim_);
-                soa_.size++;
-            }
+        // COSINE scans and the L2 decomposition in batch_search both need |x|
+        norms_.push_back(norm(v.raw() , dim_ , kernels_for(cfg_.distance)));
+
+        ntotal_++;
+    }
+
+    void LinearScanIndex::reserve(size_t n){
+        if(encoded()) codes_.reserve(n * sq_.code_size());
+        else if(cfg_.layout == LayoutType::SOA) soa_.reserve(n);
+
+        if((!encoded() && cfg_.layout == LayoutType::AOS) || binary()) aos_.reserve(n);
+
+        norms_.reserve(n);
+    }
+
+    void LinearScanIndex::add_batch(const float* data , size_t n){
+        if(n == 0) return;
+
+        constexpr size_t PARALLEL_MIN = 4096;   // below this the team start-up dominates
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        const size_t base = ntotal_;
+        const bool soa = cfg_.layout == LayoutType::SOA;
+        const bool enc = encoded();
+        const bool rows = (!enc && !soa) || binary();
+        const size_t cs = sq_.code_size();
+
+        if(enc && !is_trained()) train(data , n);
+
+        if(enc) codes_.resize((base + n) * cs);
+        else if(soa) soa_.resize(base + n);
+        if(rows) aos_.resize(base + n);
+        norms_.resize(base + n);
+        uint8_t* codes = enc ? codes_.data() : nullptr;
+
+        const bool par = cfg_.exec != ExecPolicy::SINGLE_THREAD && n >= PARALLEL_MIN;
+
+        // copy and norm in one pass, while the row is still in cache
+        #pragma omp parallel for schedule(static) num_threads(num_threads(cfg_)) if(par)
+        for(size_t i = 0 ; i<n ; ++i){
+            const float* src = data + i * dim_;
+
+            if(enc) sq_.encode(src , codes + (base + i) * cs);
+            else if(soa) soa_.set(base + i , src);
+            if(rows) copy(src , src + dim_ , aos_.row(base + i));
 
-            copy(v.raw() , v.raw() + dim_ , soa_.row(soa_.size - 1));
+            norms_[base + i] = norm(src , dim_ , kern);
         }
+
+        ntotal_ += n;
+    }
+
+    LinearScanIndex LinearScanIndex::compacted(const vector<idx_t>& remap) const {
+        assert(remap.size() == ntotal_);
+        if(raw_) throw runtime_error("LinearScanIndex: detach the refine store before compacting");
+
+        const size_t m = ntotal_ - count(remap.begin() , remap.end() , NO_ID);
+        const size_t cs = sq_.code_size();
+        const bool soa = !encoded() && cfg_.layout == LayoutType::SOA;
+        const bool rows = (!encoded() && !soa) || binary();
+
+        LinearScanIndex out(dim_ , cfg_);
+        out.sq_ = sq_;
+        if(encoded()) out.codes_.resize(m * cs);
+        else if(soa) out.soa_.resize(m);
+        if(rows) out.aos_.resize(m);
+        out.norms_.resize(m);
+
+        vector<float> x(soa ? dim_ : 0);
+        for(size_t i = 0 ; i<ntotal_ ; ++i){
+            const idx_t j = remap[i];
+            if(j == NO_ID) continue;
+            assert(j < m);
+
+            if(encoded()) copy(codes_.data() + i * cs , codes_.data() + (i + 1) * cs , out.codes_.data() + j * cs);
+            else if(soa){
+                for(dim_t d = 0 ; d<dim_ ; ++d) x[d] = soa_.at(i , d);
+                out.soa_.set(j , x.data());
+            }
+            if(rows) copy(row(i) , row(i) + dim_ , out.aos_.row(j));
+            out.norms_[j] = norms_[i];
+        }
+
+        out.ntotal_ = m;
+        return out;
     }
 
-    vector<pair<idx_t , dist_t>> LinearScanIndex::search(const Vector& query , size_t k) const {
+    vector<pair<idx_t , dist_t>> LinearScanIndex::search(const Vector& query , size_t k , const IDSelector* sel ,
+                                                         size_t refine_factor) const {
         assert (query.dim == dim_);
 
-        vector<pair<idx_t, dist_t>> results(aos_.size());
-        
-        auto compute = [&] (idx_t i) {
-            dist_t d = l2_dispatch(query , aos_[i] , cfg_.distance);
-            results[i] = {i , d};
+        if(encoded()) return search_codes(query , k , sel , refine_factor);
+
+        constexpr size_t L = VectorBlock::LANES;
+        constexpr size_t CHUNK = 256;   // rows scored per kernel round, a multiple of LANES
+        constexpr size_t DIRECT_RATIO = 16;
+        constexpr size_t ABANDON_MIN_DIM = 4 * L2_ABANDON_STEP;
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        DistanceComputer dc(query.raw() , dim_ , cfg_.metric , kern);
+        const float* norms = norms_.data();
+
+        // Row-by-row early abandon beats the fused batch kernel once a row
+        // spans a few abandon steps; only L2 has a monotone partial sum.
+        const bool abandon = cfg_.metric == Metric::L2 && cfg_.layout == LayoutType::AOS &&
+                             dim_ >= ABANDON_MIN_DIM;
+
+        // few allowed ids: random access to just those rows beats a full pass
+        if(sel && cfg_.layout == LayoutType::AOS){
+            const size_t allowed = sel->count(ntotal_);
+            vector<idx_t> ids;
+            if(allowed != IDSelector::UNKNOWN && allowed < ntotal_ / DIRECT_RATIO && sel->members(ntotal_ , ids)){
+                TopKCollector top(k);
+                for(idx_t id : ids) top.push(id , dc(row(id) , norms[id]));
+                return top.sorted_results();
+            }
+        }
+
+        // Scores rows [c*CHUNK , c*CHUNK + cnt) into a stack buffer and
+        // hands them to the collector, which keeps only what beats its k-th.
+        // Under a selector, rejected rows are not scored and get +inf.
+        auto scan_chunk = [&] (size_t c , TopKCollector& top) {
+            size_t base = c*CHUNK;
+            size_t cnt = min(CHUNK , ntotal_ - base);
+            dist_t out[CHUNK];
+
+            uint8_t keep[CHUNK];
+            if(sel){
+                size_t kept = 0;
+                for(size_t j = 0 ; j<cnt ; ++j) kept += keep[j] = sel->is_member(static_cast<idx_t>(base + j));
+                if(kept == 0) return;
+            }
+
+            if(abandon){
+                // The collector's k-th distance bounds every row, so once it
+                // is full most rows stop after one or two slices of dims.
+                for(size_t j = 0 ; j<cnt ; ++j){
+                    if(sel && !keep[j]) continue;
+                    dist_t thr = top.threshold();
+                    dist_t d = kern.l2_bounded(query.raw() , row(base + j) , dim_ , thr);
+                    if(d < thr) top.push(static_cast<idx_t>(base + j) , d);
+                }
+                return;
+            }
+
+            if(cfg_.layout == LayoutType::SOA){
+                // One kernel call scores a whole block of LANES vectors; the
+                // padded tail lanes of the last block are dropped.
+                for(size_t j = 0 ; j<cnt ; j += L){
+                    size_t lanes = min(L , cnt - j);
+                    if(sel && none_of(keep + j , keep + j + lanes , [] (uint8_t b) {return b;})){
+                        fill(out + j , out + j + lanes , numeric_limits<dist_t>::infinity());
+                        continue;
+                    }
+
+                    float block_norms[L] = {};
+                    copy(norms + base + j , norms + base + j + lanes , block_norms);
+
+                    dist_t blk[L];
+                    dc.block_distances(soa_.block((base + j) / L) , block_norms , blk);
+                    copy(blk , blk + lanes , out + j);
+                }
+                if(sel) for(size_t j = 0 ; j<cnt ; ++j) if(!keep[j]) out[j] = numeric_limits<dist_t>::infinity();
+            }else if(sel){
+                dc.selected_distances(row(base) , cnt , dim_ , norms + base , keep , out);
+            }else{
+                // Rows are contiguous, so each chunk is one one-to-many kernel call.
+                dc.distances(row(base) , cnt , dim_ , norms + base , out);
+            }
+
+            top.push_range(out , cnt , static_cast<idx_t>(base));
         };
 
+        const size_t nc = (ntotal_ + CHUNK - 1) / CHUNK;
+        TopKCollector top(k);
+
         if(cfg_.exec == ExecPolicy::OPENMP){
-            #pragma omp parralel for schedule(static)
-            for(idx_t i = 0 ; i<aos_.size() ; i++)compute(i);
+            // per-thread collectors, merged once at the end
+            #pragma omp parallel num_threads(num_threads(cfg_))
+            {
+                TopKCollector local(k);
+
+                #pragma omp for schedule(static) nowait
+                for(size_t c = 0 ; c<nc ; c++) scan_chunk(c , local);
+
+                #pragma omp critical
+                top.merge(local);
+            }
         }else{
-            for(idx_t i = 0 ; i<aos_.size() ; i++) compute(i);
+            for(size_t c = 0 ; c<nc ; c++) scan_chunk(c , top);
         }
 
-        if(results.size() > k){
-            nth_element(results.begin() , 
-                        results.begin() + k,
-                        results.end() , 
-                        [](auto& a , auto& b) {return a.second < b.second ;}
-                    );
-            results.resize(k);
+        return top.sorted_results();
+    }
+
+    vector<pair<idx_t , dist_t>> LinearScanIndex::search_codes(const Vector& query , size_t k , const IDSelector* sel ,
+                                                               size_t refine_factor) const {
+        constexpr size_t CHUNK = 256;   // rows scored per kernel round
+        constexpr size_t DIRECT_RATIO = 16;
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        const ScalarQuantizer::Query qc = sq_.prepare(query.raw() , cfg_.metric , kern);
+        const size_t cs = sq_.code_size();
+        const uint8_t* codes = codes_.data();
+        const float* norms = norms_.data();
+
+        // BINARY re-ranks against its own rows, always
+        const VectorStore* exact_rows = binary() ? &aos_ : raw_;
+        if(binary() && refine_factor == 0) refine_factor = BINARY_OVERSAMPLE;
+        const bool refine = refine_factor > 0 && exact_rows;
+        const size_t kk = refine ? k * refine_factor : k;
+
+        auto score = [&] (size_t first , size_t cnt , dist_t* out) {
+            sq_.distances(qc , cfg_.metric , kern , codes + first * cs , cnt , norms + first , out);
+        };
+
+        // Rows [c*CHUNK , c*CHUNK + cnt) in one kernel call; under a selector
+        // each run of consecutive members is one call and the rest get +inf.
+        auto scan_chunk = [&] (size_t c , TopKCollector& top) {
+            size_t base = c*CHUNK;
+            size_t cnt = min(CHUNK , ntotal_ - base);
+            dist_t out[CHUNK];
+
+            if(!sel){
+                score(base , cnt , out);
+            }else{
+                for(size_t j = 0 ; j<cnt ; ){
+                    if(!sel->is_member(static_cast<idx_t>(base + j))){
+                        out[j++] = numeric_limits<dist_t>::infinity();
+                        continue;
+                    }
+                    size_t e = j + 1;
+                    while(e < cnt && sel->is_member(static_cast<idx_t>(base + e))) ++e;
+                    score(base + j , e - j , out + j);
+                    j = e;
+                }
+            }
+
+            top.push_range(out , cnt , static_cast<idx_t>(base));
+        };
+
+        TopKCollector top(kk);
+        vector<idx_t> ids;
+        const size_t allowed = sel ? sel->count(ntotal_) : IDSelector::UNKNOWN;
+
+        if(allowed != IDSelector::UNKNOWN && allowed < ntotal_ / DIRECT_RATIO && sel->members(ntotal_ , ids)){
+            for(idx_t id : ids){
+                dist_t d;
+                score(id , 1 , &d);
+                top.push(id , d);
+            }
+        }else{
+            const size_t nc = (ntotal_ + CHUNK - 1) / CHUNK;
+
+            if(cfg_.exec == ExecPolicy::OPENMP){
+                #pragma omp parallel num_threads(num_threads(cfg_))
+                {
+                    TopKCollector local(kk);
+
+                    #pragma omp for schedule(static) nowait
+                    for(size_t c = 0 ; c<nc ; c++) scan_chunk(c , local);
+
+                    #pragma omp critical
+                    top.merge(local);
+                }
+            }else{
+                for(size_t c = 0 ; c<nc ; c++) scan_chunk(c , top);
+            }
+        }
+
+        if(!refine) return top.sorted_results();
+
+        // exact re-rank of the code shortlist
+        DistanceComputer dc(query.raw() , dim_ , cfg_.metric , kern);
+        TopKCollector exact(k);
+        for(auto& c : top.sorted_results()) exact.push(c.first , dc(exact_rows->row(c.first) , norms[c.first]));
+
+        return exact.sorted_results();
+    }
+
+    vector<pair<idx_t , dist_t>> LinearScanIndex::range_search(const Vector& query , dist_t radius) const {
+        assert (query.dim == dim_);
+
+        constexpr size_t L = VectorBlock::LANES;
+        constexpr size_t CHUNK = 256;   // a multiple of LANES
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        DistanceComputer dc(query.raw() , dim_ , cfg_.metric , kern);
+        const float* norms = norms_.data();
+
+        // Hamming distances are not metric distances: BINARY scans its rows
+        const bool codes = encoded() && !binary();
+        ScalarQuantizer::Query qc;
+        if(codes) qc = sq_.prepare(query.raw() , cfg_.metric , kern);
+
+        auto scan_chunk = [&] (size_t c , vector<pair<idx_t , dist_t>>& hits) {
+            size_t base = c*CHUNK;
+            size_t cnt = min(CHUNK , ntotal_ - base);
+
+            if(codes){
+                dist_t d[CHUNK];
+                sq_.distances(qc , cfg_.metric , kern , codes_.data() + base * sq_.code_size() , cnt , norms + base , d);
+                for(size_t j = 0 ; j<cnt ; ++j) if(d[j] < radius) hits.emplace_back(static_cast<idx_t>(base + j) , d[j]);
+                return;
+            }
+
+            if(cfg_.layout == LayoutType::SOA){
+                // interleaved lanes cannot stop early: score whole blocks
+                for(size_t j = 0 ; j<cnt ; j += L){
+                    size_t lanes = min(L , cnt - j);
+                    float block_norms[L] = {};
+                    copy(norms + base + j , norms + base + j + lanes , block_norms);
+
+                    dist_t blk[L];
+                    dc.block_distances(soa_.block((base + j) / L) , block_norms , blk);
+                    for(size_t l = 0 ; l<lanes ; ++l) if(blk[l] < radius) hits.emplace_back(static_cast<idx_t>(base + j + l) , blk[l]);
+                }
+                return;
+            }
+
+            uint32_t idx[CHUNK];
+            dist_t d[CHUNK];
+            size_t m = dc.within(row(base) , cnt , dim_ , norms + base , radius , idx , d);
+            for(size_t i = 0 ; i<m ; ++i) hits.emplace_back(static_cast<idx_t>(base + idx[i]) , d[i]);
+        };
+
+        const size_t nc = (ntotal_ + CHUNK - 1) / CHUNK;
+        vector<pair<idx_t , dist_t>> hits;
+
+        if(cfg_.exec == ExecPolicy::OPENMP){
+            #pragma omp parallel num_threads(num_threads(cfg_))
+            {
+                vector<pair<idx_t , dist_t>> local;
+
+                #pragma omp for schedule(static) nowait
+                for(size_t c = 0 ; c<nc ; c++) scan_chunk(c , local);
+
+                #pragma omp critical
+                hits.insert(hits.end() , local.begin() , local.end());
+            }
+        }else{
+            for(size_t c = 0 ; c<nc ; c++) scan_chunk(c , hits);
         }
 
-        sort(results.begin() , results.end() , 
-            [](auto& a , auto& b) {return a.second < b.second ;}
-        );
+        sort_hits(hits);
+        return hits;
+    }
 
-        return results;
+    RangeSearchResult LinearScanIndex::range_search(const vector<Vector>& queries , dist_t radius) const {
+        return range_search_batch(queries.size() , cfg_ , [&] (size_t q) {return range_search(queries[q] , radius);});
     }
 
     vector<vector<pair<idx_t, dist_t>>> LinearScanIndex::batch_search(const vector<Vector>& queries , size_t k) const {
-        vector<vector<pair<idx_t, dist_t>>> all;
+        constexpr size_t L = VectorBlock::LANES;
+        constexpr size_t MR = TILE_QUERIES;
+        constexpr size_t QUERY_BLOCK = 64;
+        constexpr size_t TILE_BYTES = 256 * 1024;   // database tile kept hot in L2
+
+        const size_t nq = queries.size();
+        vector<vector<pair<idx_t, dist_t>>> all(nq);
+        if(nq == 0 || ntotal_ == 0) return all;
+
+        if(encoded()){
+            #pragma omp parallel for schedule(dynamic , 1) num_threads(num_threads(cfg_)) if(cfg_.exec == ExecPolicy::OPENMP_BATCH)
+            for(size_t q = 0 ; q<nq ; ++q) all[q] = search(queries[q] , k);
+            return all;
+        }
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+
+        // |q|^2 for L2 (||q||^2 + ||x||^2 - 2 q.x), |q| for COSINE
+        vector<float> qnorms(nq);
+        for(size_t q = 0 ; q<nq ; ++q){
+            assert(queries[q].dim == dim_);
+            float n = norm(queries[q].raw() , dim_ , kern);
+            qnorms[q] = cfg_.metric == Metric::L2 ? n*n : n;
+        }
+
+        auto to_dist = [&] (float dot , float qn , float xn) -> dist_t {
+            switch(cfg_.metric){
+                case Metric::L2: return max(0.0f , qn + xn*xn - 2.0f*dot);
+                case Metric::INNER_PRODUCT: return -dot;
+                default: return (qn == 0.0f || xn == 0.0f) ? 1.0f : 1.0f - dot / (qn * xn);
+            }
+        };
+
+        const size_t total_blocks = VectorBlock::blocks_for(ntotal_);
+        const size_t tile_blocks = max<size_t>(1 , TILE_BYTES / (dim_ * L * sizeof(float)));
+
+        const size_t n_qblocks = (nq + QUERY_BLOCK - 1) / QUERY_BLOCK;
+
+        // Per-thread scratch: AoS rows are packed tile by tile into the
+        // blocked layout the micro-kernel reads (SOA data already is in
+        // that layout), and dots holds one MR x tile score panel.
+        struct Scratch{
+            vector<float> packed;
+            vector<float> dots;
+        };
+        auto make_scratch = [&] () {
+            return Scratch{vector<float>(cfg_.layout == LayoutType::SOA ? 0 : tile_blocks * L * dim_) ,
+                           vector<float>(MR * tile_blocks * L)};
+        };
+
+        // Scores query block qblk against database tile starting at block tb.
+        auto score_tile = [&] (size_t qblk , size_t tb , vector<TopKCollector>& tops , Scratch& scratch) {
+            const size_t qb = qblk * QUERY_BLOCK;
+            const size_t qe = min(nq , qb + QUERY_BLOCK);
+            const size_t nb = min(tile_blocks , total_blocks - tb);
+            const size_t row0 = tb * L;
+            const size_t rows = min(nb * L , ntotal_ - row0);
+
+            const float* blocks;
+            if(cfg_.layout == LayoutType::SOA){
+                blocks = soa_.block(tb);
+            }else{
+                float* packed = scratch.packed.data();
+                fill(packed , packed + nb * L * dim_ , 0.0f);
+                for(size_t j = 0 ; j<rows ; ++j){
+                    const float* x = row(row0 + j);
+                    float* blk = packed + (j / L) * dim_ * L + j % L;
+                    for(dim_t d = 0 ; d<dim_ ; ++d) blk[d * L] = x[d];
+                }
+                blocks = packed;
+            }
+
+            const size_t ld = nb * L;
+            for(size_t q = qb ; q<qe ; q += MR){
+                // pad the last group by repeating its final query
+                const float* qp[MR];
+                for(size_t r = 0 ; r<MR ; ++r) qp[r] = queries[min(q + r , qe - 1)].raw();
+
+                kern.inner_product_tile(qp , blocks , nb , dim_ , scratch.dots.data() , ld);
+
+                for(size_t r = 0 ; r<MR && q + r<qe ; ++r){
+                    TopKCollector& top = tops[q + r - qb];
+                    const float qn = qnorms[q + r];
+                    float* dot = scratch.dots.data() + r * ld;
+
+                    for(size_t j = 0 ; j<rows ; ++j) dot[j] = to_dist(dot[j] , qn , norms_[row0 + j]);
+                    top.push_range(dot , rows , static_cast<idx_t>(row0));
+                }
+            }
+        };
+
+        auto finish_block = [&] (size_t qblk , vector<TopKCollector>& tops) {
+            const size_t qb = qblk * QUERY_BLOCK;
+            for(size_t i = 0 ; i<tops.size() ; ++i) all[qb + i] = tops[i].sorted_results();
+        };
+
+        auto block_size = [&] (size_t qblk) {return min(QUERY_BLOCK , nq - qblk * QUERY_BLOCK);};
+
+        const int nt = num_threads(cfg_);
+
+        if(cfg_.exec == ExecPolicy::OPENMP_BATCH){
+            // inter-query: whole query blocks per thread, no merging needed
+            #pragma omp parallel num_threads(nt)
+            {
+                Scratch scratch = make_scratch();
+
+                #pragma omp for schedule(dynamic , 1)
+                for(size_t qblk = 0 ; qblk<n_qblocks ; ++qblk){
+                    vector<TopKCollector> tops(block_size(qblk) , TopKCollector(k));
+                    for(size_t tb = 0 ; tb<total_blocks ; tb += tile_blocks) score_tile(qblk , tb , tops , scratch);
+                    finish_block(qblk , tops);
+                }
+            }
+        }else if(cfg_.exec == ExecPolicy::OPENMP){
+            // intra-query: the database tiles of each query block are split
+            // across threads, each with its own collectors, merged per block
+            const size_t n_tiles = (total_blocks + tile_blocks - 1) / tile_blocks;
+            for(size_t qblk = 0 ; qblk<n_qblocks ; ++qblk){
+                vector<TopKCollector> tops(block_size(qblk) , TopKCollector(k));
+
+                #pragma omp parallel num_threads(nt)
+                {
+                    Scratch scratch = make_scratch();
+                    vector<TopKCollector> local(tops.size() , TopKCollector(k));
+
+                    #pragma omp for schedule(static) nowait
+                    for(size_t t = 0 ; t<n_tiles ; ++t) score_tile(qblk , t * tile_blocks , local , scratch);
+
+                    #pragma omp critical
+                    for(size_t i = 0 ; i<tops.size() ; ++i) tops[i].merge(local[i]);
+                }
 
-        for(const auto& q : queries){
-            all.emplace_back(search(q, k));
+                finish_block(qblk , tops);
+            }
+        }else{
+            Scratch scratch = make_scratch();
+            for(size_t qblk = 0 ; qblk<n_qblocks ; ++qblk){
+                vector<TopKCollector> tops(block_size(qblk) , TopKCollector(k));
+                for(size_t tb = 0 ; tb<total_blocks ; tb += tile_blocks) score_tile(qblk , tb , tops , scratch);
+                finish_block(qblk , tops);
+            }
         }
 
         return all;
     }
 }
-
@@ -7,26 +7,114 @@
 #include "../core/vector.h"
 #include "../core/distance.h"
 #include "../core/vector_block.h"
+#include "../core/topk.h"
+#include "../core/id_selector.h"
+#include "../core/range_search.h"
+#include "scalar_quantizer.h"
 
 using namespace std;
 namespace vdb {
     class LinearScanIndex{
+        friend class IndexSerializer;   // storage/serialization.h
+
         public:
+            // cfg.encoding picks the vector storage: FP32 rows (in cfg.layout),
+            // or SQ8 / FP16 / BF16 codes (row-major, see ScalarQuantizer)
+            // scanned by kernels that read the codes directly. BINARY keeps
+            // AOS fp32 rows next to its bit codes for the re-rank.
             explicit LinearScanIndex(dim_t dim , SearchConfig cfg = {}) ;
 
+            // SQ8 learns its per-dimension range (BINARY its thresholds) from
+            // n row-major vectors; add_batch() trains on its first batch when
+            // this was not called.
+            void train(const float* data , size_t n) {sq_.train(data , n);}
+
+            bool is_trained() const {return sq_.is_trained();}
+
             void add(const Vector& v);
 
-            vector<pair<idx_t , dist_t>> search(const Vector& query , size_t k) const;
+            // Bulk ingest of n row-major vectors (e.g. Dataset::data). Storage
+            // is grown once and rows are copied without building Vector
+            // objects; under an OPENMP policy the copy runs on all threads.
+            void add_batch(const float* data , size_t n);
+
+            void reserve(size_t n);
+
+            // Copy holding only the rows with remap[i] != NO_ID, row i moved
+            // to id remap[i]; kept rows must map onto 0 .. kept - 1. Codes
+            // are copied, not re-encoded. Throws while a refine store is set:
+            // its row numbers would no longer match the copy's.
+            LinearScanIndex compacted(const vector<idx_t>& remap) const;
+
+            // With a selector only member ids are returned. A small
+            // enumerable allowed set (under 1/16 of the rows, AOS layout) is
+            // scored id by id; otherwise the chunk scan checks membership
+            // before scoring and skips rejected rows.
+            //
+            // Under L2 with AOS rows of at least 4 * L2_ABANDON_STEP dims,
+            // rows are scored one by one with the early-abandon kernel
+            // bounded by the current k-th distance.
+            //
+            // With a compressed encoding, refine_factor > 0 and a refine store
+            // set, the best k * refine_factor code distances are re-scored
+            // exactly against the fp32 rows of the store.
+            //
+            // BINARY always re-ranks the best k * refine_factor Hamming
+            // distances (k * BINARY_OVERSAMPLE when 0) against its own rows.
+            // The default suits clustered data such as embeddings, where
+            // neighbours share most signs; on isotropic data (i.i.d.
+            // Gaussian) the bits carry little neighbour information and
+            // recall needs an oversample in the hundreds to thousands.
+            vector<pair<idx_t , dist_t>> search(const Vector& query , size_t k , const IDSelector* sel = nullptr ,
+                                                size_t refine_factor = 0) const;
+
+            // Row i of raw must be the vector added with id i; the store is
+            // not owned (it may be memory mapped) and must outlive searches.
+            // Unused by BINARY, which re-ranks against its own rows.
+            void set_refine_store(const VectorStore* raw) {raw_ = raw;}
+            const VectorStore* refine_store() const {return raw_;}
+
+            // All vectors with distance < radius, closest first. AOS rows
+            // under L2 use the early-abandon kernel (see bounded_kernel_t).
+            vector<pair<idx_t , dist_t>> range_search(const Vector& query , dist_t radius) const;
 
+            // Batch form, packed as CSR (see RangeSearchResult).
+            RangeSearchResult range_search(const vector<Vector>& queries , dist_t radius) const;
+
+            // Blocked query x database scan: each database tile is loaded
+            // once per block of queries and scored with the GEMM micro-kernel.
+            // Compressed encodings run search() per query instead.
             vector<vector<pair<idx_t , dist_t>>> batch_search(const vector<Vector>& queries , size_t k) const;
 
-            size_t size() const {return aos_.size();}
+            size_t size() const {return ntotal_;}
+
+            // Bytes per vector read by the scan (4 * dim for FP32, dim / 8
+            // for BINARY, which also keeps 4 * dim for the re-rank).
+            size_t code_size() const {return sq_.code_size();}
+
+            // Default BINARY re-rank oversample; too small for isotropic
+            // data, see search().
+            static constexpr size_t BINARY_OVERSAMPLE = 10;
 
         private:
+            const float* row(size_t i) const {return aos_.row(i);}
+
+            bool encoded() const {return cfg_.encoding != VectorEncoding::FP32;}
+            bool binary() const {return cfg_.encoding == VectorEncoding::BINARY;}
+
+            vector<pair<idx_t , dist_t>> search_codes(const Vector& query , size_t k , const IDSelector* sel ,
+                                                      size_t refine_factor) const;
+
             dim_t dim_;
             // vector<Vector> data_;
             SearchConfig cfg_;
-            vector<Vector> aos_;
+            size_t ntotal_ = 0;
+            VectorStore aos_;
             VectorBlock soa_;
+            MappedVector<float> norms_;    // |x| per vector, cached at add()
+            ScalarQuantizer sq_;
+            MappedVector<uint8_t> codes_;  // ntotal x code_size(), compressed encodings only
+            const VectorStore* raw_ = nullptr;
+
     };
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "pq.h"
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace vdb{
+
+    namespace {
+        // Copies sub-vector m (dsub floats at m*dsub) of n rows into a packed n x dsub buffer.
+        void extract_subspace(const float* data , size_t n , dim_t dim , size_t m , size_t dsub , float* out){
+            for(size_t i = 0 ; i<n ; ++i){
+                const float* src = data + i*dim + m*dsub;
+                copy(src , src + dsub , out + i*dsub);
+            }
+        }
+    }
+
+    ProductQuantizer::ProductQuantizer(dim_t dim , size_t M , SearchConfig cfg , size_t nbits):
+        dim_(dim) , M_(M) , dsub_(dim / M) , cfg_(cfg) , nbits_(nbits) , ksub_(size_t(1) << nbits){
+            assert(M_ > 0 && dim_ % M_ == 0);
+            assert(nbits_ == 4 || nbits_ == 8);
+        }
+
+    void ProductQuantizer::train(const float* data , size_t n , const KMeansConfig& kcfg){
+        assert(n >= ksub_);
+
+        codebooks_.clear();
+        codebooks_.reserve(M_);
+
+        vector<float> sub(n * dsub_);
+        for(size_t m = 0 ; m<M_ ; ++m){
+            extract_subspace(data , n , dim_ , m , dsub_ , sub.data());
+
+            KMeansConfig sub_cfg = kcfg;
+            sub_cfg.seed = kcfg.seed + static_cast<uint32_t>(m);
+            codebooks_.push_back(kmeans(sub.data() , n , dsub_ , ksub_ , sub_cfg , cfg_));
+        }
+    }
+
+    void ProductQuantizer::encode(const float* x , uint8_t* code) const {
+        assert(is_trained());
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+        fill(code , code + code_size() , 0);
+        for(size_t m = 0 ; m<M_ ; ++m){
+            const float* xs = x + m*dsub_;
+            const VectorStore& cb = codebooks_[m];
+
+            size_t best = 0;
+            float best_d = kern.l2(xs , cb.row(0) , dsub_);
+            for(size_t j = 1 ; j<ksub_ ; ++j){
+                float d = kern.l2(xs , cb.row(j) , dsub_);
+                if(d < best_d){best_d = d ; best = j;}
+            }
+            set_code(code , m , best);
+        }
+    }
+
+    void ProductQuantizer::encode_batch(const float* data , size_t n , uint8_t* codes) const {
+        assert(is_trained());
+
+        // bounded scratch, whatever the batch size
+        constexpr size_t CHUNK = 16384;
+
+        vector<float> sub(min(n , CHUNK) * dsub_);
+        vector<idx_t> labels(min(n , CHUNK));
+
+        const size_t cs = code_size();
+        fill(codes , codes + n*cs , 0);
+
+        for(size_t base = 0 ; base<n ; base += CHUNK){
+            size_t cnt = min(CHUNK , n - base);
+            const float* rows = data + base*dim_;
+
+            for(size_t m = 0 ; m<M_ ; ++m){
+                extract_subspace(rows , cnt , dim_ , m , dsub_ , sub.data());
+                assign_nearest(sub.data() , cnt , dsub_ , codebooks_[m] , labels.data() , nullptr , cfg_);
+
+                uint8_t* out = codes + base*cs;
+                for(size_t i = 0 ; i<cnt ; ++i) set_code(out + i*cs , m , labels[i]);
+            }
+        }
+    }
+
+    void ProductQuantizer::decode(const uint8_t* code , float* x) const {
+        assert(is_trained());
+
+        for(size_t m = 0 ; m<M_ ; ++m){
+            const float* c = codebooks_[m].row(get_code(code , m));
+            copy(c , c + dsub_ , x + m*dsub_);
+        }
+    }
+
+    void ProductQuantizer::compute_distance_table(const float* query , float* table) const {
+        assert(is_trained());
+
+        const DistanceKernels& kern = kernels_for(cfg_.distance);
+
+        float scale = -1.0f , bias = 0.0f;
+        if(cfg_.metric == Metric::COSINE){
+            float qn = norm(query , dim_ , kern);
+            scale = qn > 0.0f ? -1.0f / qn : 0.0f;
+            bias = 1.0f / static_cast<float>(M_);   // the M biases add up to the leading 1
+        }
+
+        for(size_t m = 0 ; m<M_ ; ++m){
+            const float* qs = query + m*dsub_;
+            const VectorStore& cb = codebooks_[m];
+            float* t = table + m*ksub_;
+
+            if(cfg_.metric == Metric::L2){
+                kern.l2_batch(qs , cb.data() , ksub_ , dsub_ , dsub_ , t);
+                continue;
+            }
+
+            kern.inner_product_batch(qs , cb.data() , ksub_ , dsub_ , dsub_ , t);
+            for(size_t j = 0 ; j<ksub_ ; ++j) t[j] = scale * t[j] + bias;
+        }
+    }
+
+    void ProductQuantizer::adc_distances(const float* table , const uint8_t* codes , size_t n , dist_t* out) const {
+        if(nbits_ == 8){
+            kernels_for(cfg_.distance).pq_adc(table , codes , n , M_ , out);
+            return;
+        }
+
+        // 4-bit codes are meant for fast scan; this is the exact reference path
+        const size_t cs = code_size();
+        for(size_t i = 0 ; i<n ; ++i){
+            float d = 0.0f;
+            for(size_t m = 0 ; m<M_ ; ++m) d += table[m*ksub_ + get_code(codes + i*cs , m)];
+            out[i] = d;
+        }
+    }
+
+    size_t ProductQuantizer::fastscan_size(size_t n) const {
+        constexpr size_t B = PQ_FASTSCAN_BLOCK;
+        return (n + B - 1) / B * npairs() * 2 * 16;
+    }
+
+    void ProductQuantizer::pack_fastscan(const uint8_t* codes , size_t n , uint8_t* packed) const {
+        assert(nbits_ == 4);
+
+        const size_t cs = code_size();
+
+        fill(packed , packed + fastscan_size(n) , 0);
+        for(size_t i = 0 ; i<n ; ++i) set_fastscan_code(packed , i , codes + i*cs);
+    }
+
+    void ProductQuantizer::set_fastscan_code(uint8_t* packed , size_t i , const uint8_t* code) const {
+        assert(nbits_ == 4);
+
+        constexpr size_t B = PQ_FASTSCAN_BLOCK;
+        const size_t v = i % B;
+        uint8_t* blk = packed + (i / B)*npairs()*32;
+
+        for(size_t m = 0 ; m<M_ ; ++m){
+            uint8_t c = static_cast<uint8_t>(get_code(code , m));
+            blk[m*16 + v % 16] |= v < 16 ? c : static_cast<uint8_t>(c << 4);
+        }
+    }
+
+    void ProductQuantizer::compute_fastscan_lut(const float* query , FastScanLUT& lut) const {
+        vector<float> table(M_ * ksub_);
+        compute_distance_table(query , table.data());
+        quantize_lut(table.data() , lut);
+    }
+
+    void ProductQuantizer::quantize_lut(const float* table , FastScanLUT& lut) const {
+        assert(nbits_ == 4);
+        assert(M_ * 255 <= 0xFFFF);   // sums are accumulated in uint16
+
+        // per sub-quantizer offset, one shared scale so that sums stay comparable
+        vector<float> mins(M_);
+        float max_range = 0.0f;
+        for(size_t m = 0 ; m<M_ ; ++m){
+            const float* t = table + m*ksub_;
+            float lo = *min_element(t , t + ksub_);
+            float hi = *max_element(t , t + ksub_);
+            mins[m] = lo;
+            max_range = max(max_range , hi - lo);
+        }
+
+        lut.scale = max_range > 0.0f ? 255.0f / max_range : 1.0f;
+        lut.bias = 0.0f;
+        for(float lo : mins) lut.bias += lo;
+
+        lut.lut.assign(npairs() * 32 , 0);
+        for(size_t m = 0 ; m<M_ ; ++m){
+            const float* t = table + m*ksub_;
+            for(size_t j = 0 ; j<ksub_ ; ++j){
+                float q = nearbyint((t[j] - mins[m]) * lut.scale);
+                lut.lut[m*16 + j] = static_cast<uint8_t>(min(q , 255.0f));
+            }
+        }
+    }
+
+    void ProductQuantizer::fastscan_distances(const FastScanLUT& lut , const uint8_t* packed , size_t n , dist_t* out) const {
+        constexpr size_t B = PQ_FASTSCAN_BLOCK;
+        constexpr size_t GROUP = 64;   // blocks per kernel call, 4 KB of sums
+
+        const fastscan_kernel_t scan = kernels_for(cfg_.distance).pq_fastscan;
+        const size_t nb = (n + B - 1) / B;
+        const float inv = 1.0f / lut.scale;
+
+        uint16_t sums[GROUP * B];
+        for(size_t b = 0 ; b<nb ; b += GROUP){
+            size_t cnt = min(GROUP , nb - b);
+            scan(lut.lut.data() , packed + b*npairs()*32 , cnt , npairs() , sums);
+
+            size_t first = b*B;
+            size_t last = min(n , (b + cnt)*B);
+            for(size_t i = first ; i<last ; ++i) out[i] = sums[i - first] * inv + lut.bias;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "../core/vector_block.h"
+#include "../core/distance.h"
+#include "kmeans.h"
+
+using namespace std;
+
+namespace vdb {
+
+    // Product quantizer: the vector is split into M sub-vectors of dim/M
+    // floats, each sub-space gets its own codebook of ksub() = 2^nbits
+    // centroids and a vector is stored as M centroid ids of nbits each
+    // (dim*4 -> M bytes for nbits = 8, M/2 bytes for nbits = 4).
+    //
+    // A query is scored against codes asymmetrically (ADC): one M x ksub()
+    // table of query-to-centroid partial distances is built per query, and
+    // the distance to a code is the sum of M table lookups, done in SIMD
+    // by the pq_adc dispatch kernel.
+    //
+    // With nbits = 4 the codes can also be repacked for fast scan: the
+    // table is quantized to uint8 so each sub-quantizer's 16 entries fit
+    // in one register and lookups become byte shuffles (pq_fastscan).
+    class ProductQuantizer{
+        public:
+            // Query table for fast scan: entry j of sub-quantizer m is
+            // lut[(m/2)*32 + (m%2)*16 + j], and a code's distance is
+            // approximately sum / scale + bias.
+            struct FastScanLUT{
+                aligned_vector<uint8_t> lut;
+                float scale = 1.0f;
+                float bias = 0.0f;
+            };
+
+            ProductQuantizer(dim_t dim , size_t M , SearchConfig cfg = {} , size_t nbits = 8);
+
+            // One k-means per sub-space over n row-major vectors (n >= ksub()).
+            void train(const float* data , size_t n , const KMeansConfig& kcfg = {});
+
+            bool is_trained() const {return !codebooks_.empty();}
+
+            void encode(const float* x , uint8_t* code) const;
+
+            // codes is n x code_size(); sub-spaces are assigned with
+            // assign_nearest, so large batches use the tile kernel.
+            void encode_batch(const float* data , size_t n , uint8_t* codes) const;
+
+            void decode(const uint8_t* code , float* x) const;
+
+            // table[m*KSUB + j] = partial distance of query sub-vector m to
+            // centroid j of sub-space m, so summing over a code gives:
+            //   L2            |q - x'|^2
+            //   INNER_PRODUCT -<q , x'>
+            //   COSINE        1 - <q/|q| , x'>   (base vectors assumed unit norm,
+            //                                     IVFPQIndex normalizes them)
+            // with x' the reconstruction of the code.
+            void compute_distance_table(const float* query , float* table) const;
+
+            // out[i] = ADC distance of code i, for n codes back to back.
+            void adc_distances(const float* table , const uint8_t* codes , size_t n , dist_t* out) const;
+
+            /* ---- 4-bit fast scan (nbits == 4) ---- */
+
+            // Bytes of packed codes for n vectors (n rounded up to a block).
+            size_t fastscan_size(size_t n) const;
+
+            // Repacks n codes into blocks of PQ_FASTSCAN_BLOCK = 32 vectors.
+            // Per block and pair of sub-quantizers (2p , 2p + 1) there are 32
+            // bytes: byte j of the first 16 holds sub-quantizer 2p of vector j
+            // in its low nibble and of vector j + 16 in its high nibble, the
+            // next 16 bytes do the same for 2p + 1. Padding codes are 0.
+            void pack_fastscan(const uint8_t* codes , size_t n , uint8_t* packed) const;
+
+            // ORs code i into packed blocks (zeroed up to fastscan_size(i + 1)),
+            // for lists that grow one code at a time.
+            void set_fastscan_code(uint8_t* packed , size_t i , const uint8_t* code) const;
+
+            // Quantizes an M x ksub() float table to uint8 with one scale for
+            // all sub-quantizers and a per-sub-quantizer offset.
+            void quantize_lut(const float* table , FastScanLUT& lut) const;
+
+            // quantize_lut of compute_distance_table(query).
+            void compute_fastscan_lut(const float* query , FastScanLUT& lut) const;
+
+            // out[i] = approximate distance of packed code i, i < n.
+            void fastscan_distances(const FastScanLUT& lut , const uint8_t* packed , size_t n , dist_t* out) const;
+
+            dim_t dim() const {return dim_;}
+            size_t M() const {return M_;}
+            size_t dsub() const {return dsub_;}
+            size_t nbits() const {return nbits_;}
+            size_t ksub() const {return ksub_;}
+            size_t code_size() const {return (M_ * nbits_ + 7) / 8;}
+            Metric metric() const {return cfg_.metric;}
+
+            // ksub() x dsub centroids of sub-space m
+            const VectorStore& codebook(size_t m) const {return codebooks_[m];}
+
+        private:
+            dim_t dim_;
+            size_t M_;
+            size_t dsub_;
+            SearchConfig cfg_;
+            size_t nbits_;
+            size_t ksub_;
+
+            size_t npairs() const {return (M_ + 1) / 2;}
+
+            // centroid id of sub-quantizer m in a code_size() byte code;
+            // set_code ORs into a zeroed code
+            size_t get_code(const uint8_t* code , size_t m) const {
+                return nbits_ == 8 ? code[m] : (code[m / 2] >> (4 * (m % 2))) & 15;
+            }
+
+            void set_code(uint8_t* code , size_t m , size_t c) const {
+                if(nbits_ == 8) code[m] = static_cast<uint8_t>(c);
+                else code[m / 2] |= static_cast<uint8_t>(c << (4 * (m % 2)));
+            }
+
+            vector<VectorStore> codebooks_;
+    };
+}
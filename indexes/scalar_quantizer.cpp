@@ -0,0 +1,187 @@
+#include "scalar_quantizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "../core/half.h"
+
+using namespace std;
+
+namespace vdb {
+
+    size_t ScalarQuantizer::code_size() const {
+        switch(encoding_){
+            case VectorEncoding::SQ8:  return dim_;
+            case VectorEncoding::FP16:
+            case VectorEncoding::BF16: return dim_ * sizeof(uint16_t);
+            case VectorEncoding::BINARY: return (dim_ + 7) / 8;
+            default:                   return dim_ * sizeof(float);
+        }
+    }
+
+    void ScalarQuantizer::train(const float* data , size_t n){
+        if(!needs_training() || n == 0) return;
+
+        if(encoding_ == VectorEncoding::BINARY){
+            // centring makes the bits balanced for non-zero-mean data
+            vector<double> mean(dim_ , 0.0) , dev(dim_ , 0.0);
+            for(size_t i = 0 ; i<n ; ++i) for(dim_t d = 0 ; d<dim_ ; ++d) mean[d] += data[i*dim_ + d];
+            for(dim_t d = 0 ; d<dim_ ; ++d) mean[d] /= n;
+            for(size_t i = 0 ; i<n ; ++i) for(dim_t d = 0 ; d<dim_ ; ++d) dev[d] += fabs(data[i*dim_ + d] - mean[d]);
+
+            vmin_.resize(dim_);
+            scale_.resize(dim_);
+            for(dim_t d = 0 ; d<dim_ ; ++d){
+                vmin_[d] = static_cast<float>(mean[d]);
+                scale_[d] = static_cast<float>(dev[d] / n);
+            }
+            return;
+        }
+
+        vector<float> lo(data , data + dim_) , hi = lo;
+        for(size_t i = 1 ; i<n ; ++i){
+            const float* x = data + i*dim_;
+            for(dim_t d = 0 ; d<dim_ ; ++d){
+                lo[d] = min(lo[d] , x[d]);
+                hi[d] = max(hi[d] , x[d]);
+            }
+        }
+
+        scale_.resize(dim_);
+        for(dim_t d = 0 ; d<dim_ ; ++d) scale_[d] = (hi[d] - lo[d]) / 255.0f;
+        vmin_ = move(lo);
+    }
+
+    void ScalarQuantizer::encode(const float* x , uint8_t* code) const {
+        assert(is_trained());
+
+        switch(encoding_){
+            case VectorEncoding::SQ8:
+                for(dim_t d = 0 ; d<dim_ ; ++d){
+                    float c = scale_[d] > 0.0f ? (x[d] - vmin_[d]) / scale_[d] : 0.0f;
+                    code[d] = static_cast<uint8_t>(lrintf(min(max(c , 0.0f) , 255.0f)));
+                }
+                break;
+            case VectorEncoding::FP16:
+            case VectorEncoding::BF16: {
+                const bool fp16 = encoding_ == VectorEncoding::FP16;
+                for(dim_t d = 0 ; d<dim_ ; ++d){
+                    uint16_t h = fp16 ? float_to_half(x[d]) : float_to_bf16(x[d]);
+                    memcpy(code + d*sizeof(h) , &h , sizeof(h));
+                }
+                break;
+            }
+            case VectorEncoding::BINARY:
+                fill(code , code + code_size() , 0);
+                for(dim_t d = 0 ; d<dim_ ; ++d) if(x[d] > vmin_[d]) code[d / 8] |= 1u << (d % 8);
+                break;
+            default:
+                memcpy(code , x , dim_ * sizeof(float));
+        }
+    }
+
+    void ScalarQuantizer::decode(const uint8_t* code , float* x) const {
+        switch(encoding_){
+            case VectorEncoding::SQ8:
+                for(dim_t d = 0 ; d<dim_ ; ++d) x[d] = vmin_[d] + code[d] * scale_[d];
+                break;
+            case VectorEncoding::FP16:
+            case VectorEncoding::BF16: {
+                const bool fp16 = encoding_ == VectorEncoding::FP16;
+                for(dim_t d = 0 ; d<dim_ ; ++d){
+                    uint16_t h;
+                    memcpy(&h , code + d*sizeof(h) , sizeof(h));
+                    x[d] = fp16 ? half_to_float(h) : bf16_to_float(h);
+                }
+                break;
+            }
+            case VectorEncoding::BINARY:
+                for(dim_t d = 0 ; d<dim_ ; ++d) x[d] = (code[d / 8] >> (d % 8) & 1) ? vmin_[d] + scale_[d] : vmin_[d] - scale_[d];
+                break;
+            default:
+                memcpy(x , code , dim_ * sizeof(float));
+        }
+    }
+
+    ScalarQuantizer::Query ScalarQuantizer::prepare(const float* query , Metric metric , const DistanceKernels& kern) const {
+        assert(is_trained());
+
+        Query p;
+        p.norm = norm(query , dim_ , kern);
+
+        if(encoding_ == VectorEncoding::BINARY){
+            p.bits.resize(code_size());
+            encode(query , p.bits.data());
+            return p;
+        }
+
+        if(encoding_ != VectorEncoding::SQ8){
+            p.q.assign(query , query + dim_);
+            return p;
+        }
+
+        p.q.resize(dim_);
+        if(metric == Metric::L2){
+            // a constant dimension (scale 0) only adds its fixed offset
+            p.weight.resize(dim_);
+            for(dim_t d = 0 ; d<dim_ ; ++d){
+                const float t = query[d] - vmin_[d];
+                if(scale_[d] > 0.0f){
+                    p.q[d] = t / scale_[d];
+                    p.weight[d] = scale_[d] * scale_[d];
+                }else{
+                    p.q[d] = 0.0f;
+                    p.weight[d] = 0.0f;
+                    p.bias += t * t;
+                }
+            }
+        }else{
+            for(dim_t d = 0 ; d<dim_ ; ++d){
+                p.q[d] = query[d] * scale_[d];
+                p.bias += query[d] * vmin_[d];
+            }
+        }
+
+        return p;
+    }
+
+    void ScalarQuantizer::distances(const Query& q , Metric metric , const DistanceKernels& kern ,
+                                    const uint8_t* codes , size_t n , const float* norms , dist_t* out) const {
+        if(encoding_ == VectorEncoding::BINARY){
+            kern.hamming(q.bits.data() , codes , n , code_size() , out);
+            return;
+        }
+
+        const bool l2 = metric == Metric::L2;
+        const uint16_t* halves = reinterpret_cast<const uint16_t*>(codes);
+
+        switch(encoding_){
+            case VectorEncoding::SQ8:
+                (l2 ? kern.sq8_l2 : kern.sq8_inner_product)(q.q.data() , q.weight.data() , codes , n , dim_ , out);
+                break;
+            case VectorEncoding::FP16:
+                (l2 ? kern.fp16_l2 : kern.fp16_inner_product)(q.q.data() , halves , n , dim_ , out);
+                break;
+            case VectorEncoding::BF16:
+                (l2 ? kern.bf16_l2 : kern.bf16_inner_product)(q.q.data() , halves , n , dim_ , out);
+                break;
+            default: {
+                const float* rows = reinterpret_cast<const float*>(codes);
+                (l2 ? kern.l2_batch : kern.inner_product_batch)(q.q.data() , rows , n , dim_ , dim_ , out);
+            }
+        }
+
+        if(l2){
+            if(q.bias != 0.0f) for(size_t i = 0 ; i<n ; ++i) out[i] += q.bias;
+        }else if(metric == Metric::INNER_PRODUCT){
+            for(size_t i = 0 ; i<n ; ++i) out[i] = -(out[i] + q.bias);
+        }else{
+            for(size_t i = 0 ; i<n ; ++i){
+                const float xn = norms[i];
+                out[i] = (q.norm == 0.0f || xn == 0.0f) ? 1.0f : 1.0f - (out[i] + q.bias) / (q.norm * xn);
+            }
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "../core/distance.h"
+
+using namespace std;
+
+namespace vdb {
+
+    // Per-vector scalar codes for the VectorEncoding of a scan:
+    //   SQ8   x[d] ~ vmin[d] + c[d] * scale[d], c in [0 , 255], with
+    //         [vmin , vmin + 255 * scale] the range of dim d seen at train()
+    //   FP16 / BF16  x[d] rounded to 16 bits (no training)
+    //   BINARY bit d of the code = x[d] > mean[d], with the mean of dim d
+    //         seen at train(); decodes to mean[d] +- the mean deviation
+    //   FP32  the raw floats (code_size() = 4 * dim)
+    //
+    // Queries are never quantized. prepare() moves the query into code
+    // space once instead: for SQ8 L2 the distance becomes
+    //   bias + sum_d scale[d]^2 * ((q[d] - vmin[d]) / scale[d] - c[d])^2
+    // and for inner products
+    //   <q , vmin> + sum_d (q[d] * scale[d]) * c[d]
+    // so the sq8 / fp16 / bf16 dispatch kernels score codes directly,
+    // widening them to float in registers. A BINARY query is binarized
+    // like the rows and scored by Hamming distance, for every metric: a
+    // ranking proxy only, meant to be re-ranked with the fp32 vectors.
+    class ScalarQuantizer{
+        public:
+            // Query in code space, see prepare().
+            struct Query{
+                vector<float> q;
+                vector<float> weight;   // SQ8 L2 only
+                vector<uint8_t> bits;   // BINARY only
+                float bias = 0.0f;
+                float norm = 0.0f;      // |query|, for COSINE
+            };
+
+            ScalarQuantizer(dim_t dim , VectorEncoding encoding) : dim_(dim) , encoding_(encoding) {}
+
+            VectorEncoding encoding() const {return encoding_;}
+
+            // Bytes per encoded vector.
+            size_t code_size() const;
+
+            // SQ8 learns per-dimension min / max over n row-major vectors,
+            // BINARY per-dimension mean and mean absolute deviation; the
+            // other encodings need no training.
+            void train(const float* data , size_t n);
+
+            bool is_trained() const {return !needs_training() || !vmin_.empty();}
+
+            // Values outside the trained SQ8 range are clamped to it.
+            void encode(const float* x , uint8_t* code) const;
+
+            void decode(const uint8_t* code , float* x) const;
+
+            Query prepare(const float* query , Metric metric , const DistanceKernels& kern) const;
+
+            // out[i] = metric distance of the query to code i, for n codes
+            // back to back; COSINE needs |x| per vector in norms.
+            void distances(const Query& q , Metric metric , const DistanceKernels& kern ,
+                           const uint8_t* codes , size_t n , const float* norms , dist_t* out) const;
+
+            const vector<float>& vmin() const {return vmin_;}
+            const vector<float>& scale() const {return scale_;}
+
+            // Restores a trained SQ8 range or BINARY threshold (see storage/serialization.h).
+            void set_range(vector<float> vmin , vector<float> scale) {vmin_ = move(vmin); scale_ = move(scale);}
+
+            bool needs_training() const {return encoding_ == VectorEncoding::SQ8 || encoding_ == VectorEncoding::BINARY;}
+
+        private:
+            dim_t dim_;
+            VectorEncoding encoding_;
+            vector<float> vmin_;    // SQ8: per-dimension range, BINARY: mean and deviation
+            vector<float> scale_;
+    };
+}
@@ -0,0 +1,58 @@
+#include "mmap.h"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace vdb {
+
+    static int advice_flag(MapAdvice a){
+        switch(a){
+            case MapAdvice::SEQUENTIAL: return MADV_SEQUENTIAL;
+            case MapAdvice::RANDOM:     return MADV_RANDOM;
+            case MapAdvice::WILLNEED:   return MADV_WILLNEED;
+            default:                    return MADV_NORMAL;
+        }
+    }
+
+    shared_ptr<const MappedFile> MappedFile::open(const string& path , MapOptions opts){
+        int fd = ::open(path.c_str() , O_RDONLY);
+        if(fd < 0) throw runtime_error("cannot open " + path + ": " + strerror(errno));
+
+        struct stat st;
+        if(fstat(fd , &st) != 0){
+            int err = errno;
+            ::close(fd);
+            throw runtime_error("cannot stat " + path + ": " + strerror(err));
+        }
+
+        const size_t size = static_cast<size_t>(st.st_size);
+        if(size == 0){
+            ::close(fd);
+            throw runtime_error("empty file " + path);
+        }
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if(opts.populate) flags |= MAP_POPULATE;
+#endif
+        void* addr = mmap(nullptr , size , PROT_READ , flags , fd , 0);
+        int err = errno;
+        ::close(fd);   // the mapping keeps its own reference to the file
+        if(addr == MAP_FAILED) throw runtime_error("cannot map " + path + ": " + strerror(err));
+
+        if(opts.advice != MapAdvice::NORMAL) madvise(addr , size , advice_flag(opts.advice));
+
+        return shared_ptr<const MappedFile>(new MappedFile(addr , size));
+    }
+
+    MappedFile::~MappedFile(){
+        munmap(addr_ , size_);
+    }
+}
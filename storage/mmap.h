@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstddef>
+
+using namespace std;
+namespace vdb {
+
+    // Access pattern hint passed to madvise() for the whole mapping.
+    enum class MapAdvice{
+        NORMAL,
+        SEQUENTIAL,   // linear scans: aggressive read-ahead
+        RANDOM,       // graph / tree walks: no read-ahead
+        WILLNEED      // start paging the file in now
+    };
+
+    struct MapOptions{
+        bool populate = false;              // MAP_POPULATE: fault every page in at open()
+        MapAdvice advice = MapAdvice::NORMAL;
+    };
+
+    // Read-only private mapping of a whole file. The mapping lives as long
+    // as the last shared_ptr to it, so arrays borrowed from it (see
+    // MappedVector) keep it alive on their own. Throws runtime_error when
+    // the file cannot be opened or mapped.
+    class MappedFile{
+        public:
+            static shared_ptr<const MappedFile> open(const string& path , MapOptions opts = {});
+
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const char* data() const {return static_cast<const char*>(addr_);}
+            size_t size() const {return size_;}
+
+        private:
+            MappedFile(void* addr , size_t size) : addr_(addr) , size_(size) {}
+
+            void* addr_;
+            size_t size_;
+    };
+}
@@ -0,0 +1,381 @@
+#include "serialization.h"
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+
+using namespace std;
+
+namespace vdb {
+
+    namespace {
+
+        size_t align_up(size_t x , size_t a) {return (x + a - 1) / a * a;}
+
+        void write_bytes(ostream& out , const void* p , size_t bytes){
+            if(bytes) out.write(static_cast<const char*>(p) , static_cast<streamsize>(bytes));
+        }
+
+        void write_zeros(ostream& out , size_t bytes){
+            static const char zeros[SECTION_ALIGN] = {};
+            for( ; bytes > 0 ; bytes -= min(bytes , SECTION_ALIGN)) write_bytes(out , zeros , min(bytes , SECTION_ALIGN));
+        }
+
+        // Collects the sections of one index, then lays them out and writes
+        // header, table and payloads in a single pass.
+        class FileWriter{
+            public:
+                explicit FileWriter(FileHeader h) : header_(h) {}
+
+                // A section whose payload is produced by fn (exactly count * elem bytes).
+                void add(SectionTag tag , uint32_t elem , size_t count , function<void(ostream&)> fn){
+                    SectionEntry e{static_cast<uint32_t>(tag) , elem , count , 0 , count * elem};
+                    sections_.push_back({e , move(fn)});
+                }
+
+                // A section copied from count contiguous elements at p.
+                template<typename T>
+                void add(SectionTag tag , const T* p , size_t count){
+                    add(tag , sizeof(T) , count , [p , count] (ostream& out) {write_bytes(out , p , count * sizeof(T));});
+                }
+
+                void write(const string& path){
+                    memcpy(header_.magic , INDEX_MAGIC , sizeof(INDEX_MAGIC));
+                    header_.version = INDEX_VERSION;
+                    header_.byte_order = INDEX_BYTE_ORDER;
+                    header_.nsections = static_cast<uint32_t>(sections_.size());
+
+                    size_t off = sizeof(FileHeader) + sections_.size() * sizeof(SectionEntry);
+                    for(auto& s : sections_){
+                        off = align_up(off , SECTION_ALIGN);
+                        s.entry.offset = off;
+                        off += s.entry.bytes;
+                    }
+
+                    ofstream out(path , ios::binary | ios::trunc);
+                    if(!out) throw runtime_error("cannot create " + path);
+
+                    write_bytes(out , &header_ , sizeof(header_));
+                    for(const auto& s : sections_) write_bytes(out , &s.entry , sizeof(SectionEntry));
+
+                    size_t pos = sizeof(FileHeader) + sections_.size() * sizeof(SectionEntry);
+                    for(const auto& s : sections_){
+                        write_zeros(out , s.entry.offset - pos);
+                        s.write(out);
+                        pos = s.entry.offset + s.entry.bytes;
+                        assert(static_cast<size_t>(out.tellp()) == pos);
+                    }
+
+                    out.flush();
+                    if(!out) throw runtime_error("write failed: " + path);
+                }
+
+            private:
+                struct Pending{
+                    SectionEntry entry;
+                    function<void(ostream&)> write;
+                };
+
+                FileHeader header_;
+                vector<Pending> sections_;
+        };
+
+        // Maps a file and hands out its sections after checking them
+        // against the header and the mapping.
+        class FileReader{
+            public:
+                FileReader(const string& path , IndexKind kind , MapOptions opts) :
+                    path_(path) , file_(MappedFile::open(path , opts)){
+                        if(file_->size() < sizeof(FileHeader)) fail("truncated header");
+                        memcpy(&header_ , file_->data() , sizeof(header_));
+
+                        if(memcmp(header_.magic , INDEX_MAGIC , sizeof(INDEX_MAGIC)) != 0) fail("not an index file");
+                        if(header_.byte_order != INDEX_BYTE_ORDER) fail("written on a host of other endianness");
+                        if(header_.version != INDEX_VERSION) fail("unsupported version " + to_string(header_.version));
+                        if(header_.kind != static_cast<uint32_t>(kind)) fail("holds another index kind");
+                        if(header_.dim == 0) fail("zero dimension");
+
+                        const size_t table_end = sizeof(FileHeader) + size_t(header_.nsections) * sizeof(SectionEntry);
+                        if(table_end > file_->size()) fail("truncated section table");
+                        table_ = reinterpret_cast<const SectionEntry*>(file_->data() + sizeof(FileHeader));
+                    }
+
+                const FileHeader& header() const {return header_;}
+
+                // The section tagged tag, which must hold exactly count T's.
+                template<typename T>
+                const T* section(SectionTag tag , size_t count) const {
+                    const SectionEntry& e = find(tag);
+                    if(e.elem_size != sizeof(T) || e.count != count || e.bytes != count * sizeof(T))
+                        fail("section " + to_string(e.tag) + " has the wrong size");
+                    return reinterpret_cast<const T*>(file_->data() + e.offset);
+                }
+
+                // Element count of the section tagged tag.
+                size_t count(SectionTag tag) const {return find(tag).count;}
+
+                // count T's of section tag viewed in place; they keep the mapping alive.
+                template<typename T>
+                MappedVector<T> borrow(SectionTag tag , size_t count) const {
+                    return borrow(section<T>(tag , count) , count);
+                }
+
+                template<typename T>
+                MappedVector<T> borrow(const T* p , size_t count) const {
+                    if(count == 0) return MappedVector<T>();
+                    return MappedVector<T>::borrow(p , count , file_);
+                }
+
+                const shared_ptr<const MappedFile>& file() const {return file_;}
+
+                [[noreturn]] void fail(const string& why) const {throw runtime_error(path_ + ": " + why);}
+
+            private:
+                const SectionEntry& find(SectionTag tag) const {
+                    for(size_t s = 0 ; s<header_.nsections ; ++s){
+                        const SectionEntry& e = table_[s];
+                        if(e.tag != static_cast<uint32_t>(tag)) continue;
+                        if(e.offset % SECTION_ALIGN != 0 || e.offset > file_->size() || e.bytes > file_->size() - e.offset)
+                            fail("section " + to_string(e.tag) + " out of bounds");
+                        return e;
+                    }
+                    fail("missing section " + to_string(static_cast<uint32_t>(tag)));
+                }
+
+                string path_;
+                shared_ptr<const MappedFile> file_;
+                FileHeader header_;
+                const SectionEntry* table_;
+        };
+
+        FileHeader make_header(IndexKind kind , size_t dim , size_t ntotal , const SearchConfig& cfg){
+            FileHeader h{};
+            h.kind = static_cast<uint32_t>(kind);
+            h.dim = dim;
+            h.ntotal = ntotal;
+            h.metric = static_cast<uint32_t>(cfg.metric);
+            h.layout = static_cast<uint32_t>(cfg.layout);
+            return h;
+        }
+
+        // The file decides what the stored arrays mean; the caller keeps
+        // the execution settings.
+        SearchConfig stored_config(const FileReader& r , SearchConfig cfg){
+            const FileHeader& h = r.header();
+            if(h.metric > static_cast<uint32_t>(Metric::COSINE)) r.fail("unknown metric");
+            if(h.layout > static_cast<uint32_t>(LayoutType::SOA)) r.fail("unknown layout");
+            cfg.metric = static_cast<Metric>(h.metric);
+            cfg.layout = static_cast<LayoutType>(h.layout);
+            return cfg;
+        }
+
+        // Floats a list of n vectors occupies: n rows, or whole 8-wide blocks.
+        size_t list_floats(size_t n , size_t dim , LayoutType layout){
+            return layout == LayoutType::SOA ? VectorBlock::blocks_for(n) * VectorBlock::LANES * dim : n * dim;
+        }
+    }
+
+    /* ---------------- linear scan ---------------- */
+
+    void IndexSerializer::save(const LinearScanIndex& index , const string& path){
+        const size_t n = index.ntotal_ , dim = index.dim_;
+        FileHeader h = make_header(IndexKind::LINEAR_SCAN , dim , n , index.cfg_);
+        h.param0 = static_cast<uint64_t>(index.cfg_.encoding);
+        FileWriter w(h);
+
+        vector<float> range;
+        if(index.encoded()){
+            w.add(SectionTag::CODES , index.codes_.data() , n * index.sq_.code_size());
+            if(index.sq_.needs_training() && index.is_trained()){
+                range = index.sq_.vmin();
+                range.insert(range.end() , index.sq_.scale().begin() , index.sq_.scale().end());
+                w.add(SectionTag::SQ_RANGE , range.data() , range.size());
+            }
+            if(index.binary()) w.add(SectionTag::VECTORS , index.aos_.data() , n * dim);
+        }else if(index.cfg_.layout == LayoutType::SOA){
+            w.add(SectionTag::VECTORS , index.soa_.data.data() , list_floats(n , dim , LayoutType::SOA));
+        }else{
+            w.add(SectionTag::VECTORS , index.aos_.data() , n * dim);
+        }
+        w.add(SectionTag::NORMS , index.norms_.data() , n);
+
+        w.write(path);
+    }
+
+    LinearScanIndex IndexSerializer::load_linear_scan(const string& path , SearchConfig cfg , MapOptions opts){
+        FileReader r(path , IndexKind::LINEAR_SCAN , opts);
+        const FileHeader& h = r.header();
+        const size_t n = h.ntotal , dim = h.dim;
+
+        if(h.param0 > static_cast<uint64_t>(VectorEncoding::BINARY)) r.fail("unknown encoding");
+        cfg = stored_config(r , cfg);
+        cfg.encoding = static_cast<VectorEncoding>(h.param0);
+
+        LinearScanIndex index(dim , cfg);
+        const LayoutType layout = index.cfg_.layout;
+
+        if(index.encoded()){
+            if(index.sq_.needs_training() && n > 0){
+                const float* range = r.section<float>(SectionTag::SQ_RANGE , 2 * dim);
+                index.sq_.set_range(vector<float>(range , range + dim) , vector<float>(range + dim , range + 2 * dim));
+            }
+            index.codes_ = r.borrow<uint8_t>(SectionTag::CODES , n * index.sq_.code_size());
+            if(index.binary() && n > 0) index.aos_.borrow(r.section<float>(SectionTag::VECTORS , n * dim) , n , r.file());
+        }else{
+            const float* v = r.section<float>(SectionTag::VECTORS , list_floats(n , dim , layout));
+
+            if(layout == LayoutType::SOA){
+                index.soa_.size = n;
+                index.soa_.data = r.borrow(v , list_floats(n , dim , layout));
+            }else if(n > 0){
+                index.aos_.borrow(v , n , r.file());
+            }
+        }
+        index.norms_ = r.borrow<float>(SectionTag::NORMS , n);
+        index.ntotal_ = n;
+
+        return index;
+    }
+
+    /* ---------------- IVF ---------------- */
+
+    // Each list is written as one run (its chunks back to back), starting
+    // on a 64-byte boundary. Every chunk but the last of a list is full
+    // and a multiple of LANES long, so SOA chunks concatenate into the
+    // blocked layout of the whole list.
+    void IndexSerializer::save(const IVFIndex& index , const string& path){
+        constexpr size_t ALIGN_FLOATS = SECTION_ALIGN / sizeof(float);
+
+        const size_t dim = index.dim_ , nlist = index.nlist_;
+        const LayoutType layout = index.cfg_.layout;
+
+        FileHeader h = make_header(IndexKind::IVF , dim , index.ntotal_ , index.cfg_);
+        h.param0 = nlist;
+        FileWriter w(h);
+
+        vector<ListEntry> dir(nlist);
+        size_t floats = 0 , ids = 0;
+        for(size_t l = 0 ; l<nlist ; ++l){
+            const InvertedList& list = index.lists_[l];
+            dir[l] = ListEntry{list.size() , floats , ids};
+            floats = align_up(floats + list_floats(list.size() , dim , layout) , ALIGN_FLOATS);
+            ids += list.size();
+        }
+
+        w.add(SectionTag::CENTROIDS , index.centroids_.data() , index.centroids_.size() * dim);
+        w.add(SectionTag::LIST_DIR , dir.data() , nlist);
+
+        w.add(SectionTag::LIST_DATA , sizeof(float) , floats , [&] (ostream& out) {
+            size_t pos = 0;
+            for(size_t l = 0 ; l<nlist ; ++l){
+                const auto& chunks = index.lists_[l].chunks();
+                write_zeros(out , (dir[l].data - pos) * sizeof(float));
+                pos = dir[l].data;
+                for(size_t c = 0 ; c<chunks.size() ; ++c){
+                    assert(layout == LayoutType::AOS || c + 1 == chunks.size() || chunks[c].size % VectorBlock::LANES == 0);
+                    const size_t len = list_floats(chunks[c].size , dim , layout);
+                    write_bytes(out , chunks[c].data.data() , len * sizeof(float));
+                    pos += len;
+                }
+            }
+            write_zeros(out , (floats - pos) * sizeof(float));
+        });
+
+        w.add(SectionTag::LIST_IDS , sizeof(idx_t) , ids , [&] (ostream& out) {
+            for(const auto& list : index.lists_)
+                for(const auto& c : list.chunks()) write_bytes(out , c.ids.data() , c.size * sizeof(idx_t));
+        });
+
+        w.add(SectionTag::LIST_NORMS , sizeof(float) , ids , [&] (ostream& out) {
+            for(const auto& list : index.lists_)
+                for(const auto& c : list.chunks()) write_bytes(out , c.norms.data() , c.size * sizeof(float));
+        });
+
+        w.write(path);
+    }
+
+    IVFIndex IndexSerializer::load_ivf(const string& path , SearchConfig cfg , MapOptions opts){
+        FileReader r(path , IndexKind::IVF , opts);
+        const FileHeader& h = r.header();
+        const size_t dim = h.dim , nlist = h.param0;
+
+        IVFIndex index(dim , nlist , stored_config(r , cfg));
+        const LayoutType layout = index.cfg_.layout;
+
+        const size_t ncent = r.count(SectionTag::CENTROIDS) / dim;
+        if(ncent != 0 && ncent != nlist) r.fail("centroid count does not match nlist");
+        if(ncent) index.centroids_.borrow(r.section<float>(SectionTag::CENTROIDS , ncent * dim) , ncent , r.file());
+
+        const ListEntry* dir = r.section<ListEntry>(SectionTag::LIST_DIR , nlist);
+        const size_t nfloats = r.count(SectionTag::LIST_DATA) , nids = r.count(SectionTag::LIST_IDS);
+        const float* data = r.section<float>(SectionTag::LIST_DATA , nfloats);
+        const idx_t* ids = r.section<idx_t>(SectionTag::LIST_IDS , nids);
+        const float* norms = r.section<float>(SectionTag::LIST_NORMS , nids);
+
+        size_t total = 0;
+        for(size_t l = 0 ; l<nlist ; ++l){
+            const ListEntry& e = dir[l];
+            if(e.size == 0) continue;
+
+            const size_t len = list_floats(e.size , dim , layout);
+            if(e.data > nfloats || len > nfloats - e.data || e.ids > nids || e.size > nids - e.ids)
+                r.fail("list " + to_string(l) + " out of bounds");
+
+            // SOA capacity covers the padded tail block, so an append
+            // after loading fills that block rather than starting a chunk
+            InvertedList::Chunk c;
+            c.capacity = len / dim;
+            c.size = e.size;
+            c.data = r.borrow(data + e.data , len);
+            c.ids = r.borrow(ids + e.ids , e.size);
+            c.norms = r.borrow(norms + e.ids , e.size);
+
+            InvertedList& list = index.lists_[l];
+            list.chunks_.push_back(move(c));
+            list.size_ = e.size;
+            total += e.size;
+        }
+        if(total != h.ntotal) r.fail("list sizes do not add up to ntotal");
+        index.ntotal_ = total;
+
+        return index;
+    }
+
+    /* ---------------- KD-tree ---------------- */
+
+    void IndexSerializer::save(const KDTree& index , const string& path){
+        const size_t n = index.data_.size() , dim = index.dim_;
+
+        FileHeader h = make_header(IndexKind::KD_TREE , dim , n , index.cfg_);
+        h.param0 = index.leaf_size_;
+        h.param1 = index.depth_;
+        FileWriter w(h);
+
+        w.add(SectionTag::VECTORS , index.data_.data() , n * dim);
+        w.add(SectionTag::IDS , index.ids_.data() , n);
+        w.add(SectionTag::ROWS , index.rows_.data() , n);
+        w.add(SectionTag::NODES , index.nodes_.data() , index.nodes_.size());
+
+        w.write(path);
+    }
+
+    KDTree IndexSerializer::load_kd_tree(const string& path , SearchConfig cfg , MapOptions opts){
+        FileReader r(path , IndexKind::KD_TREE , opts);
+        const FileHeader& h = r.header();
+        const size_t n = h.ntotal , dim = h.dim , depth = h.param1;
+
+        if(h.param0 == 0 || h.param0 > KDTree::MAX_LEAF) r.fail("bad leaf size");
+        if(depth >= 48 || ((n + (size_t(1) << depth) - 1) >> depth) > KDTree::MAX_LEAF) r.fail("bad depth");
+
+        KDTree index(dim , stored_config(r , cfg) , h.param0);
+        index.depth_ = depth;
+
+        if(n > 0) index.data_.borrow(r.section<float>(SectionTag::VECTORS , n * dim) , n , r.file());
+        index.ids_ = r.borrow<idx_t>(SectionTag::IDS , n);
+        index.rows_ = r.borrow<idx_t>(SectionTag::ROWS , n);
+        index.nodes_ = r.borrow<KDTree::Node>(SectionTag::NODES , (size_t(1) << depth) - 1);
+
+        return index;
+    }
+}
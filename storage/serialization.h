@@ -0,0 +1,122 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "../core/types.h"
+#include "../indexes/linear_scan.h"
+#include "../indexes/ivf.h"
+#include "../indexes/kd_tree.h"
+#include "mmap.h"
+
+using namespace std;
+namespace vdb {
+
+    // On-disk index format (native endianness, little-endian in practice):
+    //
+    //   FileHeader      64 bytes
+    //   SectionEntry[]  32 bytes each, header.nsections of them
+    //   sections        each starting on a 64-byte boundary
+    //
+    // Every array an index searches (vectors, norms, ids, tree nodes ...)
+    // is one section written exactly as it sits in memory, so loading maps
+    // the file and points the index at the sections: no parse, no copy,
+    // and pages are faulted in by the first searches that touch them (or
+    // up front with MapOptions::populate). Vector sections start on a
+    // cache line, as the SIMD kernels expect of owned storage.
+    //
+    // A loaded index is fully usable; the first add() or build() copies
+    // the arrays it modifies into owned memory.
+
+    constexpr char INDEX_MAGIC[8] = {'V' , 'D' , 'B' , 'I' , 'N' , 'D' , 'E' , 'X'};
+    constexpr uint32_t INDEX_VERSION = 1;
+    constexpr uint32_t INDEX_BYTE_ORDER = 0x01020304;   // reads back swapped on a foreign-endian host
+    constexpr size_t SECTION_ALIGN = 64;
+
+    enum class IndexKind : uint32_t{
+        LINEAR_SCAN = 1,
+        IVF = 2,
+        KD_TREE = 3
+    };
+
+    enum class SectionTag : uint32_t{
+        VECTORS = 1,       // rows (AOS) or 8-wide blocks (SOA)
+        NORMS = 2,
+        IDS = 3,
+        ROWS = 4,          // KD-tree: row of each original id
+        NODES = 5,         // KD-tree: (split , axis) in heap order
+        CENTROIDS = 6,
+        LIST_DIR = 7,      // IVF: one ListEntry per list
+        LIST_DATA = 8,     // IVF: vectors of every list, each list 64-byte aligned
+        LIST_IDS = 9,
+        LIST_NORMS = 10,
+        CODES = 11,        // linear scan: compressed rows (VectorEncoding)
+        SQ_RANGE = 12      // SQ8: vmin then scale, BINARY: mean then deviation, dim floats each
+    };
+
+    struct FileHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t kind;          // IndexKind
+        uint64_t dim;
+        uint64_t ntotal;
+        uint32_t metric;        // Metric
+        uint32_t layout;        // LayoutType
+        uint64_t param0;        // IVF: nlist; KD-tree: leaf size; linear scan: VectorEncoding
+        uint64_t param1;        // KD-tree: depth
+        uint32_t nsections;
+        uint32_t byte_order;    // INDEX_BYTE_ORDER
+    };
+    static_assert(sizeof(FileHeader) == 64 , "FileHeader must stay 64 bytes");
+
+    struct SectionEntry{
+        uint32_t tag;           // SectionTag
+        uint32_t elem_size;
+        uint64_t count;
+        uint64_t offset;        // from the start of the file, SECTION_ALIGN aligned
+        uint64_t bytes;
+    };
+    static_assert(sizeof(SectionEntry) == 32 , "SectionEntry must stay 32 bytes");
+
+    // One IVF posting list: size vectors at element offset data of
+    // LIST_DATA, ids and norms at element offset ids of LIST_IDS / LIST_NORMS.
+    struct ListEntry{
+        uint64_t size;
+        uint64_t data;
+        uint64_t ids;
+    };
+    static_assert(sizeof(ListEntry) == 24 , "ListEntry must stay 24 bytes");
+
+    // Reads and writes the private arrays of the indexes (a friend of each).
+    class IndexSerializer{
+        public:
+            static void save(const LinearScanIndex& index , const string& path);
+            static void save(const IVFIndex& index , const string& path);
+            static void save(const KDTree& index , const string& path);
+
+            static LinearScanIndex load_linear_scan(const string& path , SearchConfig cfg , MapOptions opts);
+            static IVFIndex load_ivf(const string& path , SearchConfig cfg , MapOptions opts);
+            static KDTree load_kd_tree(const string& path , SearchConfig cfg , MapOptions opts);
+    };
+
+    // Writes the index to path, replacing any existing file. Throws
+    // runtime_error on I/O failure.
+    inline void save_index(const LinearScanIndex& index , const string& path) {IndexSerializer::save(index , path);}
+    inline void save_index(const IVFIndex& index , const string& path) {IndexSerializer::save(index , path);}
+    inline void save_index(const KDTree& index , const string& path) {IndexSerializer::save(index , path);}
+
+    // Maps an index written by save_index(). Metric and layout come from
+    // the file; the rest of cfg (kernels, threads) is the caller's. Throws
+    // runtime_error on a missing, truncated or foreign file.
+    inline LinearScanIndex load_linear_scan(const string& path , SearchConfig cfg = {} , MapOptions opts = {}){
+        return IndexSerializer::load_linear_scan(path , cfg , opts);
+    }
+
+    inline IVFIndex load_ivf(const string& path , SearchConfig cfg = {} , MapOptions opts = {}){
+        return IndexSerializer::load_ivf(path , cfg , opts);
+    }
+
+    inline KDTree load_kd_tree(const string& path , SearchConfig cfg = {} , MapOptions opts = {}){
+        return IndexSerializer::load_kd_tree(path , cfg , opts);
+    }
+}